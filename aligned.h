@@ -0,0 +1,115 @@
+#pragma once
+
+#include <cstddef>  // size_t
+#include <limits>
+#include <new>
+#include <numeric>  // std::gcd
+#include <stdexcept>
+#include <type_traits>
+
+#include "shared.h"
+#include "unique.h"
+
+// Cache line / AVX-512 register width
+inline constexpr size_t kSimdAlignment = 64;
+
+// Smallest element count >= `size` whose storage ends on an `alignment` boundary, so vector
+// loops can run over the padded tail instead of peeling it off. Throws std::invalid_argument on
+// a zero alignment and std::bad_array_new_length if the padded storage does not fit in size_t.
+template <typename T>
+size_t AlignedPaddedSize(size_t size, size_t alignment = kSimdAlignment) {
+    if (alignment == 0) {
+        throw std::invalid_argument("alignment must not be zero");
+    }
+    size_t step = alignment / std::gcd(alignment, sizeof(T));
+    if (size > std::numeric_limits<size_t>::max() - (step - 1)) {
+        throw std::bad_array_new_length();
+    }
+    size_t padded = (size + step - 1) / step * step;
+    if (padded > std::numeric_limits<size_t>::max() / sizeof(T)) {
+        throw std::bad_array_new_length();
+    }
+    return padded;
+}
+
+template <typename T>
+class AlignedDeleter;
+
+// `size` is the padded element count, every element of which was constructed
+template <typename T>
+class AlignedDeleter<T[]> {
+public:
+    AlignedDeleter() = default;
+
+    AlignedDeleter(size_t size, size_t alignment) : size_(size), alignment_(alignment) {
+    }
+
+    void operator()(T* ptr) {
+        if (ptr == nullptr) {
+            return;
+        }
+        if constexpr (!std::is_trivially_destructible_v<T>) {
+            for (size_t i = size_; i > 0; --i) {
+                ptr[i - 1].~T();
+            }
+        }
+        ::operator delete[](ptr, std::align_val_t(alignment_));
+    }
+
+    size_t GetSize() const {
+        return size_;
+    }
+
+    size_t GetAlignment() const {
+        return alignment_;
+    }
+
+private:
+    size_t size_ = 0;
+    size_t alignment_ = alignof(T);
+};
+
+namespace aligned_detail {
+
+// Value-initializes `AlignedPaddedSize(size)` elements, padding included
+template <typename T>
+T* AllocateAligned(size_t size, size_t alignment) {
+    if (alignment < alignof(T) || (alignment & (alignment - 1)) != 0) {
+        throw std::invalid_argument("alignment must be a power of two not below alignof(T)");
+    }
+    size_t padded = AlignedPaddedSize<T>(size, alignment);
+    auto* ptr = static_cast<T*>(::operator new[](padded * sizeof(T), std::align_val_t(alignment)));
+    size_t constructed = 0;
+    try {
+        for (; constructed < padded; ++constructed) {
+            new (ptr + constructed) T();
+        }
+    } catch (...) {
+        AlignedDeleter<T[]>(constructed, alignment)(ptr);
+        throw;
+    }
+    return ptr;
+}
+
+}  // namespace aligned_detail
+
+template <typename T>
+std::enable_if_t<std::is_unbounded_array_v<T>, UniquePtr<T, AlignedDeleter<T>>> MakeUniqueAligned(
+    size_t size, size_t alignment = kSimdAlignment) {
+    using Element = std::remove_extent_t<T>;
+    Element* ptr = aligned_detail::AllocateAligned<Element>(size, alignment);
+    return UniquePtr<T, AlignedDeleter<T>>(
+        ptr, AlignedDeleter<T>(AlignedPaddedSize<Element>(size, alignment), alignment));
+}
+
+// Shared owner of the first element of an aligned, padded array
+template <typename T>
+std::enable_if_t<std::is_unbounded_array_v<T>, SharedPtr<std::remove_extent_t<T>>>
+MakeSharedAligned(size_t size, size_t alignment = kSimdAlignment) {
+    using Element = std::remove_extent_t<T>;
+    auto array = MakeUniqueAligned<T>(size, alignment);
+    auto* block = new ControlBlockPointerDeleter<Element, AlignedDeleter<T>>(
+        array.Get(), std::move(array.GetDeleter()));
+    Element* ptr = array.Release();
+    return SharedPtr<Element>(block, ptr);
+}
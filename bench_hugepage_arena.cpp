@@ -0,0 +1,134 @@
+// Pointer-chasing benchmark: dTLB load misses of MakeShared vs MakeSharedInArena.
+// Build: g++ -std=c++20 -O2 bench_hugepage_arena.cpp -o bench_hugepage_arena
+
+#include "hugepage_arena.h"
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <numeric>
+#include <random>
+#include <vector>
+
+struct Node {
+    SharedPtr<Node> next;
+    int64_t payload[3] = {};
+};
+
+class DtlbMissCounter {
+public:
+    DtlbMissCounter() {
+        perf_event_attr attr{};
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HW_CACHE;
+        attr.config = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                      (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        fd_ = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+    }
+
+    ~DtlbMissCounter() {
+        if (fd_ >= 0) {
+            close(fd_);
+        }
+    }
+
+    bool IsAvailable() const {
+        return fd_ >= 0;
+    }
+
+    void Start() {
+        if (fd_ >= 0) {
+            ioctl(fd_, PERF_EVENT_IOC_RESET, 0);
+            ioctl(fd_, PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+
+    int64_t Stop() {
+        int64_t count = -1;
+        if (fd_ >= 0) {
+            ioctl(fd_, PERF_EVENT_IOC_DISABLE, 0);
+            if (read(fd_, &count, sizeof(count)) != sizeof(count)) {
+                count = -1;
+            }
+        }
+        return count;
+    }
+
+private:
+    int fd_ = -1;
+};
+
+// Links the nodes in a random order so that every hop lands on an unrelated page
+template <typename Factory>
+SharedPtr<Node> BuildChain(size_t size, Factory make_node) {
+    std::vector<SharedPtr<Node>> nodes;
+    nodes.reserve(size);
+    for (size_t i = 0; i < size; ++i) {
+        nodes.push_back(make_node());
+        nodes.back()->payload[0] = static_cast<int64_t>(i);
+    }
+    std::vector<size_t> order(size);
+    std::iota(order.begin(), order.end(), 0);
+    std::shuffle(order.begin(), order.end(), std::mt19937_64(42));
+    for (size_t i = 0; i + 1 < size; ++i) {
+        nodes[order[i]]->next = nodes[order[i + 1]];
+    }
+    return nodes[order[0]];
+}
+
+// Unlinks iteratively, the recursive destructor would overflow the stack
+void DestroyChain(SharedPtr<Node> head) {
+    while (head) {
+        SharedPtr<Node> next = std::move(head->next);
+        head = std::move(next);
+    }
+}
+
+template <typename Factory>
+void Run(const char* name, size_t size, int rounds, Factory make_node) {
+    SharedPtr<Node> head = BuildChain(size, make_node);
+    DtlbMissCounter counter;
+    int64_t sum = 0;
+
+    counter.Start();
+    auto start = std::chrono::steady_clock::now();
+    for (int round = 0; round < rounds; ++round) {
+        for (Node* node = head.Get(); node != nullptr; node = node->next.Get()) {
+            sum += node->payload[0];
+        }
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    int64_t misses = counter.Stop();
+
+    double ns_per_hop = std::chrono::duration<double, std::nano>(elapsed).count() /
+                        (static_cast<double>(size) * rounds);
+    if (counter.IsAvailable()) {
+        std::printf("%-10s %8.2f ns/hop %14lld dTLB misses (checksum %lld)\n", name, ns_per_hop,
+                    static_cast<long long>(misses), static_cast<long long>(sum));
+    } else {
+        std::printf("%-10s %8.2f ns/hop   dTLB misses n/a (checksum %lld)\n", name, ns_per_hop,
+                    static_cast<long long>(sum));
+    }
+    DestroyChain(std::move(head));
+}
+
+int main(int argc, char** argv) {
+    size_t size = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : size_t{1} << 22;
+    int rounds = argc > 2 ? std::atoi(argv[2]) : 5;
+
+    Run("heap", size, rounds, [] { return MakeShared<Node>(); });
+
+    HugePageArena arena;
+    Run("hugepage", size, rounds, [&arena] { return MakeSharedInArena<Node>(arena); });
+    return 0;
+}
@@ -0,0 +1,165 @@
+#pragma once
+
+#include <cstddef>  // size_t
+#include <initializer_list>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "shared.h"
+
+// Copy-on-write value: copies share the object, `Mut()` clones it first if anybody else can see
+// it (Rust's `Arc::make_mut`). Only strong references exist, so the block has no weak counter.
+template <typename T>
+class CowPtr {
+public:
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Constructors
+
+    CowPtr() : data_(MakeSharedNoWeak<T>()) {
+    }
+
+    explicit CowPtr(T value) : data_(MakeSharedNoWeak<T>(std::move(value))) {
+    }
+
+    // Throws std::invalid_argument on a null pointer: a `CowPtr` always holds a value
+    explicit CowPtr(SharedPtr<T, NoWeak> data) : data_(std::move(data)) {
+        if (!data_) {
+            throw std::invalid_argument("CowPtr needs a value");
+        }
+    }
+
+    // No move operations: a move copies, so the source keeps sharing the value instead of being
+    // left null. That costs one counter increment.
+    CowPtr(const CowPtr&) = default;
+    CowPtr& operator=(const CowPtr&) = default;
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Modifiers
+
+    // Unique access to the value, cloning it if it is shared. Do not keep the reference across
+    // a copy of this pointer: writes through it would show in the copy.
+    T& Mut() {
+        if (!data_.IsUnique()) {
+            data_ = MakeSharedNoWeak<T>(*data_);
+        }
+        return *data_;
+    }
+
+    void Swap(CowPtr& other) {
+        data_.Swap(other.data_);
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Observers
+
+    const T& Get() const {
+        return *data_;
+    }
+    const T& operator*() const {
+        return *data_;
+    }
+    const T* operator->() const {
+        return data_.Get();
+    }
+    size_t UseCount() const {
+        return data_.UseCount();
+    }
+    // Also false while an adopted `std::shared_ptr` has other owners
+    bool IsUnique() const {
+        return data_.IsUnique();
+    }
+    // Whether both share one object, i.e. no copy has been made yet
+    bool SharesWith(const CowPtr& other) const {
+        return data_ == other.data_;
+    }
+
+private:
+    SharedPtr<T, NoWeak> data_;
+};
+
+template <typename T, typename... Args>
+CowPtr<T> MakeCow(Args&&... args) {
+    return CowPtr<T>(MakeSharedNoWeak<T>(std::forward<Args>(args)...));
+}
+
+template <typename T>
+bool operator==(const CowPtr<T>& left, const CowPtr<T>& right) {
+    return left.SharesWith(right) || *left == *right;
+}
+
+// `std::vector` with copy-on-write copies: passing it around by value costs a counter increment,
+// the first modification of a shared copy costs one deep copy
+template <typename T>
+class CowVector {
+public:
+    using const_iterator = typename std::vector<T>::const_iterator;
+
+    CowVector() = default;
+
+    CowVector(std::initializer_list<T> values) : data_(std::vector<T>(values)) {
+    }
+
+    explicit CowVector(std::vector<T> values) : data_(std::move(values)) {
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Modifiers
+
+    void PushBack(T value) {
+        data_.Mut().push_back(std::move(value));
+    }
+
+    void PopBack() {
+        data_.Mut().pop_back();
+    }
+
+    void Set(size_t index, T value) {
+        data_.Mut()[index] = std::move(value);
+    }
+
+    void Clear() {
+        if (data_.IsUnique()) {
+            data_.Mut().clear();
+        } else {
+            data_ = CowPtr<std::vector<T>>();  // no point copying what is about to be dropped
+        }
+    }
+
+    // Direct access for batches of changes; see `CowPtr::Mut`
+    std::vector<T>& Mut() {
+        return data_.Mut();
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Observers
+
+    const T& operator[](size_t index) const {
+        return (*data_)[index];
+    }
+    size_t Size() const {
+        return data_->size();
+    }
+    bool Empty() const {
+        return data_->empty();
+    }
+    const std::vector<T>& Get() const {
+        return *data_;
+    }
+    const_iterator begin() const {
+        return data_->begin();
+    }
+    const_iterator end() const {
+        return data_->end();
+    }
+    bool SharesWith(const CowVector& other) const {
+        return data_.SharesWith(other.data_);
+    }
+
+    bool operator==(const CowVector& other) const {
+        return data_ == other.data_;
+    }
+
+private:
+    CowPtr<std::vector<T>> data_;
+};
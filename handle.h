@@ -0,0 +1,176 @@
+#pragma once
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <cstddef>  // size_t
+#include <utility>
+
+#include "compressed_pair.h"
+#include "shared.h"
+
+// `UniquePtr` for resources that are not pointers. Traits describe the resource:
+//     using Handle = ...;                  // cheap to copy, comparable with ==
+//     static Handle Null();                // "no resource" value
+//     void Close(Handle handle);           // may be static; stateful traits are stored too
+// Stateless traits take no space thanks to `CompressedPair`.
+template <typename Traits>
+class UniqueHandle {
+public:
+    using Handle = typename Traits::Handle;
+
+protected:
+    CompressedPair<Handle, Traits> data_;
+
+public:
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Constructors
+
+    UniqueHandle() noexcept : data_(Traits::Null(), Traits()) {
+    }
+
+    explicit UniqueHandle(Handle handle, Traits traits = Traits()) noexcept
+        : data_(handle, std::move(traits)) {
+    }
+
+    UniqueHandle(const UniqueHandle& other) = delete;
+
+    UniqueHandle(UniqueHandle&& other) noexcept
+        : data_(other.Release(), std::move(other.GetTraits())) {
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // `operator=`-s
+
+    UniqueHandle& operator=(const UniqueHandle& other) = delete;
+
+    UniqueHandle& operator=(UniqueHandle&& other) noexcept {
+        if (this == &other) {
+            return *this;
+        }
+        Reset(other.Release());
+        GetTraits() = std::move(other.GetTraits());
+        return *this;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Destructor
+
+    ~UniqueHandle() {
+        Reset();
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Modifiers
+
+    Handle Release() noexcept {
+        Handle handle = Get();
+        data_.GetFirst() = Traits::Null();
+        return handle;
+    }
+
+    void Reset(Handle handle = Traits::Null()) noexcept {
+        Handle old_handle = Get();
+        data_.GetFirst() = handle;
+        if (!(old_handle == Traits::Null())) {
+            GetTraits().Close(old_handle);
+        }
+    }
+
+    void Swap(UniqueHandle& other) noexcept {
+        std::swap(data_.GetFirst(), other.data_.GetFirst());
+        std::swap(data_.GetSecond(), other.data_.GetSecond());
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Observers
+
+    Handle Get() const noexcept {
+        return data_.GetFirst();
+    }
+    Traits& GetTraits() noexcept {
+        return data_.GetSecond();
+    }
+    const Traits& GetTraits() const noexcept {
+        return data_.GetSecond();
+    }
+    explicit operator bool() const noexcept {
+        return !(Get() == Traits::Null());
+    }
+};
+
+// Shared ownership of a handle: one allocation holding the control block and the `UniqueHandle`
+template <typename Traits>
+class SharedHandle {
+public:
+    using Handle = typename Traits::Handle;
+
+    SharedHandle() = default;
+
+    explicit SharedHandle(UniqueHandle<Traits>&& handle) {
+        if (handle) {
+            owner_ = MakeShared<UniqueHandle<Traits>>(std::move(handle));
+        }
+    }
+
+    explicit SharedHandle(Handle handle) : SharedHandle(UniqueHandle<Traits>(handle)) {
+    }
+
+    void Reset() {
+        owner_.Reset();
+    }
+
+    Handle Get() const {
+        return owner_ ? owner_->Get() : Traits::Null();
+    }
+
+    size_t UseCount() const {
+        return owner_.UseCount();
+    }
+
+    explicit operator bool() const {
+        return static_cast<bool>(owner_);
+    }
+
+private:
+    SharedPtr<UniqueHandle<Traits>> owner_;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Common traits
+
+// File descriptors, sockets, epoll / eventfd / timerfd handles
+struct FdTraits {
+    using Handle = int;
+
+    static int Null() {
+        return -1;
+    }
+
+    static void Close(int fd) {
+        close(fd);
+    }
+};
+
+struct MmapRegion {
+    void* address = nullptr;
+    size_t length = 0;
+
+    bool operator==(const MmapRegion& other) const = default;
+};
+
+struct MmapTraits {
+    using Handle = MmapRegion;
+
+    static MmapRegion Null() {
+        return {};
+    }
+
+    static void Close(MmapRegion region) {
+        munmap(region.address, region.length);
+    }
+};
+
+using UniqueFd = UniqueHandle<FdTraits>;
+using SharedFd = SharedHandle<FdTraits>;
+using UniqueMmapRegion = UniqueHandle<MmapTraits>;
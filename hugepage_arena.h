@@ -0,0 +1,173 @@
+#pragma once
+
+#include <sys/mman.h>
+
+#include <cstddef>  // size_t
+#include <cstdint>
+#include <new>
+#include <vector>
+
+#include "shared.h"
+
+// Bump allocator over 2 MB regions backed by transparent huge pages, with per-size free lists.
+// Keeps small shared objects packed on few TLB entries. Memory goes back to the OS only when the
+// arena is destroyed, so the arena must outlive every pointer allocated from it.
+class HugePageArena {
+public:
+    static constexpr size_t kRegionSize = size_t{2} << 20;
+    static constexpr size_t kGranularity = 16;
+    static constexpr size_t kMaxObjectSize = kRegionSize / 8;  // bigger ones go to `operator new`
+
+    // The free list heads take ~128 KB, so they live on the heap and an arena can be a local
+    HugePageArena() : free_lists_(kMaxObjectSize / kGranularity + 1) {
+    }
+
+    HugePageArena(const HugePageArena&) = delete;
+    HugePageArena& operator=(const HugePageArena&) = delete;
+
+    ~HugePageArena() {
+        for (void* region : regions_) {
+            munmap(region, kRegionSize);
+        }
+    }
+
+    void* Allocate(size_t bytes) {
+        size_t size = RoundUp(bytes);
+        if (size > kMaxObjectSize) {
+            return ::operator new(size);
+        }
+        FreeChunk*& free_list = free_lists_[size / kGranularity];
+        if (free_list != nullptr) {
+            FreeChunk* chunk = free_list;
+            free_list = chunk->next;
+            return chunk;
+        }
+        if (static_cast<size_t>(end_ - cursor_) < size) {
+            MapRegion();
+        }
+        void* result = cursor_;
+        cursor_ += size;
+        return result;
+    }
+
+    void Deallocate(void* ptr, size_t bytes) {
+        size_t size = RoundUp(bytes);
+        if (size > kMaxObjectSize) {
+            ::operator delete(ptr);
+            return;
+        }
+        FreeChunk*& free_list = free_lists_[size / kGranularity];
+        free_list = new (ptr) FreeChunk{free_list};
+    }
+
+    size_t GetRegionCount() const {
+        return regions_.size();
+    }
+
+private:
+    struct FreeChunk {
+        FreeChunk* next;
+    };
+
+    static size_t RoundUp(size_t bytes) {
+        return (bytes + kGranularity - 1) / kGranularity * kGranularity;
+    }
+
+    // mmap does not promise 2 MB alignment, so map twice as much and trim both ends
+    void MapRegion() {
+        void* mapped = mmap(nullptr, 2 * kRegionSize, PROT_READ | PROT_WRITE,
+                            MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (mapped == MAP_FAILED) {
+            throw std::bad_alloc();
+        }
+        auto begin = reinterpret_cast<uintptr_t>(mapped);
+        uintptr_t aligned = (begin + kRegionSize - 1) / kRegionSize * kRegionSize;
+        if (aligned != begin) {
+            munmap(mapped, aligned - begin);
+        }
+        munmap(reinterpret_cast<void*>(aligned + kRegionSize), begin + kRegionSize - aligned);
+
+        auto* region = reinterpret_cast<char*>(aligned);
+#ifdef MADV_HUGEPAGE
+        madvise(region, kRegionSize, MADV_HUGEPAGE);
+#endif
+        regions_.push_back(region);
+        cursor_ = region;
+        end_ = region + kRegionSize;
+    }
+
+private:
+    std::vector<void*> regions_;
+    char* cursor_ = nullptr;
+    char* end_ = nullptr;
+    std::vector<FreeChunk*> free_lists_;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Control blocks
+
+template <typename T>
+class ArenaControlBlockHolder : public ControlBlockHolder<T> {
+    static_assert(alignof(T) <= HugePageArena::kGranularity);
+
+public:
+    template <typename... Args>
+    ArenaControlBlockHolder(HugePageArena* arena, Args&&... args)
+        : ControlBlockHolder<T>(std::forward<Args>(args)...), arena_(arena) {
+    }
+
+    void DestroyBlock() override {
+        HugePageArena* arena = arena_;
+        this->~ArenaControlBlockHolder();
+        arena->Deallocate(this, sizeof(ArenaControlBlockHolder));
+    }
+
+private:
+    HugePageArena* arena_;
+};
+
+template <typename T>
+class ArenaControlBlockPointer : public ControlBlockPointer<T> {
+public:
+    ArenaControlBlockPointer(HugePageArena* arena, T* ptr)
+        : ControlBlockPointer<T>(ptr), arena_(arena) {
+    }
+
+    void DestroyBlock() override {
+        HugePageArena* arena = arena_;
+        this->~ArenaControlBlockPointer();
+        arena->Deallocate(this, sizeof(ArenaControlBlockPointer));
+    }
+
+private:
+    HugePageArena* arena_;
+};
+
+// `MakeShared` with the block (and the object inside it) carved out of `arena`
+template <typename T, typename... Args>
+SharedPtr<T> MakeSharedInArena(HugePageArena& arena, Args&&... args) {
+    void* memory = arena.Allocate(sizeof(ArenaControlBlockHolder<T>));
+    ArenaControlBlockHolder<T>* block;
+    try {
+        block = new (memory) ArenaControlBlockHolder<T>(&arena, std::forward<Args>(args)...);
+    } catch (...) {
+        arena.Deallocate(memory, sizeof(ArenaControlBlockHolder<T>));
+        throw;
+    }
+    return SharedPtr<T>(block, block->GetPointer());
+}
+
+// `SharedPtr(ptr)` with only the control block placed in `arena`. Deletes `ptr` if the block
+// cannot be allocated.
+template <typename T>
+SharedPtr<T> AdoptInArena(HugePageArena& arena, T* ptr) {
+    void* memory;
+    try {
+        memory = arena.Allocate(sizeof(ArenaControlBlockPointer<T>));
+    } catch (...) {
+        delete ptr;
+        throw;
+    }
+    auto* block = new (memory) ArenaControlBlockPointer<T>(&arena, ptr);
+    return SharedPtr<T>(block, ptr);
+}
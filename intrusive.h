@@ -0,0 +1,197 @@
+#pragma once
+
+#include <cstddef>  // std::nullptr_t
+#include <utility>  // std::exchange / std::swap
+
+class SimpleCounter {
+public:
+    size_t IncRef() {
+        return ++count_;
+    }
+
+    size_t DecRef() {
+        return --count_;
+    }
+
+    size_t RefCount() const {
+        return count_;
+    }
+
+private:
+    size_t count_ = 0;
+};
+
+struct DefaultDelete {
+    template <typename T>
+    static void Destroy(T* object) {
+        delete object;
+    }
+};
+
+// Base class of intrusively counted objects: `struct Node : SimpleRefCounted<Node> { ... };`
+template <typename Derived, typename Counter, typename Deleter>
+class RefCounted {
+public:
+    RefCounted() = default;
+
+    // A copy is a new object: it starts without references
+    RefCounted(const RefCounted&) {
+    }
+
+    RefCounted& operator=(const RefCounted&) {
+        return *this;
+    }
+
+    // Increase reference counter
+    void IncRef() {
+        counter_.IncRef();
+    }
+
+    // Decrease reference counter. Destroy object using Deleter when the last instance dies.
+    void DecRef() {
+        if (counter_.DecRef() == 0) {
+            Deleter::Destroy(static_cast<Derived*>(this));
+        }
+    }
+
+    // Get current counter value (the number of strong references)
+    size_t RefCount() const {
+        return counter_.RefCount();
+    }
+
+    // The counter itself, e.g. for `IntrusiveWeakPtr` to reach the side table
+    Counter& GetCounter() {
+        return counter_;
+    }
+
+private:
+    Counter counter_;
+};
+
+template <typename Derived, typename D = DefaultDelete>
+using SimpleRefCounted = RefCounted<Derived, SimpleCounter, D>;
+
+// https://www.boost.org/doc/libs/release/libs/smart_ptr/doc/html/smart_ptr.html#intrusive_ptr
+template <typename T>
+class IntrusivePtr {
+    template <typename Y>
+    friend class IntrusivePtr;
+
+    T* ptr_;
+
+    void IncrementCounter() {
+        if (ptr_ != nullptr) {
+            ptr_->IncRef();
+        }
+    }
+
+    void DecrementCounter() {
+        if (ptr_ != nullptr) {
+            ptr_->DecRef();
+        }
+    }
+
+public:
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Constructors
+
+    IntrusivePtr() : ptr_(nullptr) {
+    }
+
+    IntrusivePtr(std::nullptr_t) : ptr_(nullptr) {
+    }
+
+    IntrusivePtr(T* ptr) : ptr_(ptr) {
+        IncrementCounter();
+    }
+
+    template <typename Y>
+    IntrusivePtr(const IntrusivePtr<Y>& other) : ptr_(other.ptr_) {
+        IncrementCounter();
+    }
+
+    template <typename Y>
+    IntrusivePtr(IntrusivePtr<Y>&& other) : ptr_(std::exchange(other.ptr_, nullptr)) {
+    }
+
+    IntrusivePtr(const IntrusivePtr& other) : ptr_(other.ptr_) {
+        IncrementCounter();
+    }
+
+    IntrusivePtr(IntrusivePtr&& other) : ptr_(std::exchange(other.ptr_, nullptr)) {
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // `operator=`-s
+
+    IntrusivePtr& operator=(const IntrusivePtr& other) {
+        if (this == &other) {
+            return *this;
+        }
+        IntrusivePtr(other).Swap(*this);
+        return *this;
+    }
+
+    IntrusivePtr& operator=(IntrusivePtr&& other) {
+        if (this == &other) {
+            return *this;
+        }
+        IntrusivePtr(std::move(other)).Swap(*this);
+        return *this;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Destructor
+
+    ~IntrusivePtr() {
+        DecrementCounter();
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Modifiers
+
+    void Reset() {
+        DecrementCounter();
+        ptr_ = nullptr;
+    }
+
+    void Reset(T* ptr) {
+        IntrusivePtr(ptr).Swap(*this);
+    }
+
+    void Swap(IntrusivePtr& other) {
+        std::swap(ptr_, other.ptr_);
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Observers
+
+    T* Get() const {
+        return ptr_;
+    }
+    T& operator*() const {
+        return *ptr_;
+    }
+    T* operator->() const {
+        return ptr_;
+    }
+    size_t UseCount() const {
+        if (ptr_ == nullptr) {
+            return 0;
+        }
+        return ptr_->RefCount();
+    }
+    explicit operator bool() const {
+        return ptr_ != nullptr;
+    }
+};
+
+template <typename T, typename U>
+bool operator==(const IntrusivePtr<T>& left, const IntrusivePtr<U>& right) {
+    return left.Get() == right.Get();
+}
+
+template <typename T, typename... Args>
+IntrusivePtr<T> MakeIntrusive(Args&&... args) {
+    return IntrusivePtr<T>(new T(std::forward<Args>(args)...));
+}
@@ -0,0 +1,217 @@
+#pragma once
+
+#include <cstddef>  // size_t
+#include <iterator>
+
+#include "intrusive.h"
+
+// Links of one list membership, embedded in the element. Derive from one hook per list the
+// element may be in, telling them apart by `Tag`:
+//     struct Connection : SimpleRefCounted<Connection>,
+//                         IntrusiveListHook<LruTag>,
+//                         IntrusiveListHook<ReadyTag> { ... };
+template <typename Tag = void>
+class IntrusiveListHook {
+    template <typename T, typename ListTag>
+    friend class IntrusiveList;
+
+public:
+    IntrusiveListHook() = default;
+
+    // Copies of an element start outside every list
+    IntrusiveListHook(const IntrusiveListHook&) {
+    }
+
+    IntrusiveListHook& operator=(const IntrusiveListHook&) {
+        return *this;
+    }
+
+    bool IsLinked() const {
+        return next_ != nullptr;
+    }
+
+private:
+    IntrusiveListHook* prev_ = nullptr;
+    IntrusiveListHook* next_ = nullptr;
+};
+
+// Doubly linked list threaded through `IntrusiveListHook<Tag>`. Inserting and erasing never
+// allocate. The list holds a reference to each element, so an element stays alive while linked.
+// The list is neither copyable nor movable: the elements point at its sentinel.
+template <typename T, typename Tag = void>
+class IntrusiveList {
+    using Hook = IntrusiveListHook<Tag>;
+
+public:
+    template <typename Element, typename HookPtr>
+    class Iterator {
+        friend class IntrusiveList;
+
+    public:
+        using iterator_category = std::bidirectional_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+        using pointer = Element*;
+        using reference = Element&;
+
+        Iterator() = default;
+
+        Element& operator*() const {
+            return *operator->();
+        }
+        Element* operator->() const {
+            return static_cast<Element*>(node_);
+        }
+        Iterator& operator++() {
+            node_ = node_->next_;
+            return *this;
+        }
+        Iterator operator++(int) {
+            Iterator old = *this;
+            ++*this;
+            return old;
+        }
+        Iterator& operator--() {
+            node_ = node_->prev_;
+            return *this;
+        }
+        Iterator operator--(int) {
+            Iterator old = *this;
+            --*this;
+            return old;
+        }
+        bool operator==(const Iterator& other) const = default;
+
+    private:
+        explicit Iterator(HookPtr node) : node_(node) {
+        }
+
+        HookPtr node_ = nullptr;
+    };
+
+    using iterator = Iterator<T, Hook*>;
+    using const_iterator = Iterator<const T, const Hook*>;
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Constructors
+
+    IntrusiveList() {
+        head_.prev_ = &head_;
+        head_.next_ = &head_;
+    }
+
+    IntrusiveList(const IntrusiveList&) = delete;
+    IntrusiveList& operator=(const IntrusiveList&) = delete;
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Destructor
+
+    ~IntrusiveList() {
+        Clear();
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Modifiers
+
+    // `element` must not be in a list with this `Tag` already
+    void PushBack(const IntrusivePtr<T>& element) {
+        element->IncRef();
+        LinkBefore(&head_, element.Get());
+    }
+
+    void PushFront(const IntrusivePtr<T>& element) {
+        element->IncRef();
+        LinkBefore(head_.next_, element.Get());
+    }
+
+    // Returns the first element, or nullptr if the list is empty
+    IntrusivePtr<T> PopFront() {
+        if (Empty()) {
+            return nullptr;
+        }
+        IntrusivePtr<T> element(&Front());
+        Erase(Front());
+        return element;
+    }
+
+    IntrusivePtr<T> PopBack() {
+        if (Empty()) {
+            return nullptr;
+        }
+        IntrusivePtr<T> element(&Back());
+        Erase(Back());
+        return element;
+    }
+
+    // `element` must be in this list. Drops the list's reference, which may destroy the element.
+    void Erase(T& element) {
+        Unlink(&element);
+        element.DecRef();
+    }
+
+    // Reorders without touching the reference count, e.g. to mark an LRU entry as used
+    void MoveToBack(T& element) {
+        Unlink(&element);
+        LinkBefore(&head_, &element);
+    }
+
+    void MoveToFront(T& element) {
+        Unlink(&element);
+        LinkBefore(head_.next_, &element);
+    }
+
+    void Clear() {
+        while (!Empty()) {
+            Erase(Front());
+        }
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Observers
+
+    T& Front() const {
+        return static_cast<T&>(*head_.next_);
+    }
+    T& Back() const {
+        return static_cast<T&>(*head_.prev_);
+    }
+    size_t Size() const {
+        return size_;
+    }
+    bool Empty() const {
+        return size_ == 0;
+    }
+
+    iterator begin() {
+        return iterator(head_.next_);
+    }
+    iterator end() {
+        return iterator(&head_);
+    }
+    const_iterator begin() const {
+        return const_iterator(head_.next_);
+    }
+    const_iterator end() const {
+        return const_iterator(&head_);
+    }
+
+private:
+    void LinkBefore(Hook* position, Hook* node) {
+        node->prev_ = position->prev_;
+        node->next_ = position;
+        position->prev_->next_ = node;
+        position->prev_ = node;
+        ++size_;
+    }
+
+    void Unlink(Hook* node) {
+        node->prev_->next_ = node->next_;
+        node->next_->prev_ = node->prev_;
+        node->prev_ = nullptr;
+        node->next_ = nullptr;
+        --size_;
+    }
+
+    Hook head_;
+    size_t size_ = 0;
+};
@@ -0,0 +1,400 @@
+#pragma once
+
+#include <cstddef>  // size_t
+#include <functional>
+#include <iterator>
+
+#include "intrusive.h"
+
+// Links of one tree membership, embedded in the element (see `IntrusiveListHook` for tags)
+template <typename Tag = void>
+class IntrusiveTreeHook {
+    template <typename T, typename Compare, typename TreeTag>
+    friend class IntrusiveTree;
+
+public:
+    IntrusiveTreeHook() = default;
+
+    // Copies of an element start outside every tree
+    IntrusiveTreeHook(const IntrusiveTreeHook&) {
+    }
+
+    IntrusiveTreeHook& operator=(const IntrusiveTreeHook&) {
+        return *this;
+    }
+
+    bool IsLinked() const {
+        return parent_ != nullptr;
+    }
+
+private:
+    IntrusiveTreeHook* parent_ = nullptr;
+    IntrusiveTreeHook* left_ = nullptr;
+    IntrusiveTreeHook* right_ = nullptr;
+    bool red_ = false;
+};
+
+// Red-black tree threaded through `IntrusiveTreeHook<Tag>`, ordered by `Compare` over `T`.
+// Equal elements are allowed and kept in insertion order, so the tree works as a timer queue.
+// Inserting and erasing never allocate; the tree holds a reference to each element.
+// The tree is neither copyable nor movable: the elements point at its sentinel.
+template <typename T, typename Compare = std::less<T>, typename Tag = void>
+class IntrusiveTree {
+    using Hook = IntrusiveTreeHook<Tag>;
+
+public:
+    class Iterator {
+        friend class IntrusiveTree;
+
+    public:
+        using iterator_category = std::bidirectional_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+        using pointer = T*;
+        using reference = T&;
+
+        Iterator() = default;
+
+        T& operator*() const {
+            return *operator->();
+        }
+        T* operator->() const {
+            return static_cast<T*>(node_);
+        }
+        Iterator& operator++() {
+            node_ = tree_->Next(node_);
+            return *this;
+        }
+        Iterator operator++(int) {
+            Iterator old = *this;
+            ++*this;
+            return old;
+        }
+        Iterator& operator--() {
+            node_ = node_ == &tree_->nil_ ? tree_->Maximum(tree_->root_) : tree_->Prev(node_);
+            return *this;
+        }
+        Iterator operator--(int) {
+            Iterator old = *this;
+            --*this;
+            return old;
+        }
+        bool operator==(const Iterator& other) const {
+            return node_ == other.node_;
+        }
+
+    private:
+        Iterator(const IntrusiveTree* tree, Hook* node) : tree_(tree), node_(node) {
+        }
+
+        const IntrusiveTree* tree_ = nullptr;
+        Hook* node_ = nullptr;
+    };
+
+    using iterator = Iterator;
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Constructors
+
+    explicit IntrusiveTree(Compare compare = Compare()) : compare_(std::move(compare)) {
+        root_ = &nil_;
+    }
+
+    IntrusiveTree(const IntrusiveTree&) = delete;
+    IntrusiveTree& operator=(const IntrusiveTree&) = delete;
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Destructor
+
+    ~IntrusiveTree() {
+        Clear();
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Modifiers
+
+    // `element` must not be in a tree with this `Tag` already. O(log n).
+    void Insert(const IntrusivePtr<T>& element) {
+        element->IncRef();
+        Link(element.Get());
+    }
+
+    // `element` must be in this tree. Drops the tree's reference, which may destroy the element.
+    void Erase(T& element) {
+        Unlink(&element);
+        element.DecRef();
+    }
+
+    // Repositions an element whose key has changed, keeping the tree's reference
+    void Update(T& element) {
+        Unlink(&element);
+        Link(&element);
+    }
+
+    // Returns the smallest element, or nullptr if the tree is empty
+    IntrusivePtr<T> PopFront() {
+        if (Empty()) {
+            return nullptr;
+        }
+        IntrusivePtr<T> element(&Front());
+        Erase(Front());
+        return element;
+    }
+
+    void Clear() {
+        while (!Empty()) {
+            Erase(Front());
+        }
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Observers
+
+    T& Front() const {
+        return static_cast<T&>(*Minimum(root_));
+    }
+    T& Back() const {
+        return static_cast<T&>(*Maximum(root_));
+    }
+    size_t Size() const {
+        return size_;
+    }
+    bool Empty() const {
+        return size_ == 0;
+    }
+
+    // First element not ordered before `key`; `Compare` must accept `(const T&, const Key&)`
+    template <typename Key>
+    iterator LowerBound(const Key& key) const {
+        Hook* result = &nil_;
+        for (Hook* node = root_; node != &nil_;) {
+            if (compare_(static_cast<const T&>(*node), key)) {
+                node = node->right_;
+            } else {
+                result = node;
+                node = node->left_;
+            }
+        }
+        return iterator(this, result);
+    }
+
+    iterator begin() const {
+        return iterator(this, Minimum(root_));
+    }
+    iterator end() const {
+        return iterator(this, &nil_);
+    }
+
+private:
+    bool Less(Hook* left, Hook* right) const {
+        return compare_(static_cast<const T&>(*left), static_cast<const T&>(*right));
+    }
+
+    Hook* Minimum(Hook* node) const {
+        if (node == &nil_) {
+            return &nil_;
+        }
+        while (node->left_ != &nil_) {
+            node = node->left_;
+        }
+        return node;
+    }
+
+    Hook* Maximum(Hook* node) const {
+        if (node == &nil_) {
+            return &nil_;
+        }
+        while (node->right_ != &nil_) {
+            node = node->right_;
+        }
+        return node;
+    }
+
+    Hook* Next(Hook* node) const {
+        if (node->right_ != &nil_) {
+            return Minimum(node->right_);
+        }
+        Hook* parent = node->parent_;
+        while (parent != &nil_ && node == parent->right_) {
+            node = parent;
+            parent = parent->parent_;
+        }
+        return parent;
+    }
+
+    Hook* Prev(Hook* node) const {
+        if (node->left_ != &nil_) {
+            return Maximum(node->left_);
+        }
+        Hook* parent = node->parent_;
+        while (parent != &nil_ && node == parent->left_) {
+            node = parent;
+            parent = parent->parent_;
+        }
+        return parent;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Red-black balancing, after Cormen et al., "Introduction to Algorithms", chapter 13
+
+    void RotateLeft(Hook* node) {
+        Hook* child = node->right_;
+        node->right_ = child->left_;
+        if (child->left_ != &nil_) {
+            child->left_->parent_ = node;
+        }
+        Replace(node, child);
+        child->left_ = node;
+        node->parent_ = child;
+    }
+
+    void RotateRight(Hook* node) {
+        Hook* child = node->left_;
+        node->left_ = child->right_;
+        if (child->right_ != &nil_) {
+            child->right_->parent_ = node;
+        }
+        Replace(node, child);
+        child->right_ = node;
+        node->parent_ = child;
+    }
+
+    void Rotate(Hook* node, bool left) {
+        if (left) {
+            RotateLeft(node);
+        } else {
+            RotateRight(node);
+        }
+    }
+
+    // Puts `replacement` where `node` hangs from its parent
+    void Replace(Hook* node, Hook* replacement) {
+        if (node->parent_ == &nil_) {
+            root_ = replacement;
+        } else if (node == node->parent_->left_) {
+            node->parent_->left_ = replacement;
+        } else {
+            node->parent_->right_ = replacement;
+        }
+        replacement->parent_ = node->parent_;
+    }
+
+    void Link(Hook* node) {
+        Hook* position = &nil_;
+        for (Hook* current = root_; current != &nil_;) {
+            position = current;
+            current = Less(node, current) ? current->left_ : current->right_;
+        }
+        node->parent_ = position;
+        if (position == &nil_) {
+            root_ = node;
+        } else if (Less(node, position)) {
+            position->left_ = node;
+        } else {
+            position->right_ = node;
+        }
+        node->left_ = &nil_;
+        node->right_ = &nil_;
+        node->red_ = true;
+        ++size_;
+
+        while (node->parent_->red_) {
+            Hook* parent = node->parent_;
+            Hook* grandparent = parent->parent_;
+            bool left_side = parent == grandparent->left_;
+            Hook* uncle = left_side ? grandparent->right_ : grandparent->left_;
+            if (uncle->red_) {
+                parent->red_ = false;
+                uncle->red_ = false;
+                grandparent->red_ = true;
+                node = grandparent;
+                continue;
+            }
+            if (node == (left_side ? parent->right_ : parent->left_)) {
+                node = parent;
+                Rotate(node, left_side);
+                parent = node->parent_;
+            }
+            parent->red_ = false;
+            grandparent->red_ = true;
+            Rotate(grandparent, !left_side);
+        }
+        root_->red_ = false;
+    }
+
+    void Unlink(Hook* node) {
+        Hook* moved = node;
+        bool removed_red = moved->red_;
+        Hook* child;
+        if (node->left_ == &nil_) {
+            child = node->right_;
+            Replace(node, node->right_);
+        } else if (node->right_ == &nil_) {
+            child = node->left_;
+            Replace(node, node->left_);
+        } else {
+            moved = Minimum(node->right_);
+            removed_red = moved->red_;
+            child = moved->right_;
+            if (moved->parent_ == node) {
+                child->parent_ = moved;
+            } else {
+                Replace(moved, moved->right_);
+                moved->right_ = node->right_;
+                moved->right_->parent_ = moved;
+            }
+            Replace(node, moved);
+            moved->left_ = node->left_;
+            moved->left_->parent_ = moved;
+            moved->red_ = node->red_;
+        }
+        if (!removed_red) {
+            RebalanceAfterUnlink(child);
+        }
+        node->parent_ = nullptr;
+        node->left_ = nullptr;
+        node->right_ = nullptr;
+        node->red_ = false;
+        --size_;
+    }
+
+    void RebalanceAfterUnlink(Hook* node) {
+        while (node != root_ && !node->red_) {
+            Hook* parent = node->parent_;
+            bool left_side = node == parent->left_;
+            Hook* sibling = left_side ? parent->right_ : parent->left_;
+            if (sibling->red_) {
+                sibling->red_ = false;
+                parent->red_ = true;
+                Rotate(parent, left_side);
+                sibling = left_side ? parent->right_ : parent->left_;
+            }
+            Hook* near = left_side ? sibling->left_ : sibling->right_;
+            Hook* far = left_side ? sibling->right_ : sibling->left_;
+            if (!near->red_ && !far->red_) {
+                sibling->red_ = true;
+                node = parent;
+                continue;
+            }
+            if (!far->red_) {
+                near->red_ = false;
+                sibling->red_ = true;
+                Rotate(sibling, !left_side);
+                sibling = left_side ? parent->right_ : parent->left_;
+                far = left_side ? sibling->right_ : sibling->left_;
+            }
+            sibling->red_ = parent->red_;
+            parent->red_ = false;
+            far->red_ = false;
+            Rotate(parent, left_side);
+            node = root_;
+        }
+        node->red_ = false;
+    }
+
+private:
+    Compare compare_;
+    mutable Hook nil_;  // shared leaf; its `parent_` is scratch space during `Unlink`
+    Hook* root_;
+    size_t size_ = 0;
+};
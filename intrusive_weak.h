@@ -0,0 +1,216 @@
+#pragma once
+
+#include <cstddef>  // size_t
+#include <cstdint>
+#include <utility>
+
+#include "intrusive.h"
+
+// Counts of an object which has been weakly referenced. The object holds one weak reference of
+// its own while alive, so the table outlives both the object and the last `IntrusiveWeakPtr`.
+class IntrusiveSideTable {
+public:
+    explicit IntrusiveSideTable(size_t strong) : strong_(strong) {
+    }
+
+    size_t IncRef() {
+        return ++strong_;
+    }
+
+    size_t DecRef() {
+        return --strong_;
+    }
+
+    size_t RefCount() const {
+        return strong_;
+    }
+
+    void IncWeak() {
+        ++weak_;
+    }
+
+    void DecWeak() {
+        if (--weak_ == 0) {
+            delete this;
+        }
+    }
+
+    size_t WeakCount() const {
+        return weak_ - (strong_ > 0 ? 1 : 0);
+    }
+
+private:
+    size_t strong_;
+    size_t weak_ = 1;
+};
+
+// Counter word of `WeakRefCounted` objects, the size of `SimpleCounter`. It holds the strong count
+// inline until the first weak reference is taken; from then on it points at a side table.
+// (The low bit tells the two apart: counts are stored shifted left by one.)
+class SideTableCounter {
+public:
+    SideTableCounter() = default;
+
+    SideTableCounter(const SideTableCounter&) = delete;
+    SideTableCounter& operator=(const SideTableCounter&) = delete;
+
+    ~SideTableCounter() {
+        if (HasSideTable()) {
+            GetTable()->DecWeak();
+        }
+    }
+
+    size_t IncRef() {
+        if (HasSideTable()) {
+            return GetTable()->IncRef();
+        }
+        bits_ += 2;
+        return bits_ >> 1;
+    }
+
+    size_t DecRef() {
+        if (HasSideTable()) {
+            return GetTable()->DecRef();
+        }
+        bits_ -= 2;
+        return bits_ >> 1;
+    }
+
+    size_t RefCount() const {
+        return HasSideTable() ? GetTable()->RefCount() : bits_ >> 1;
+    }
+
+    // Allocates the side table on first use
+    IntrusiveSideTable* GetSideTable() {
+        if (!HasSideTable()) {
+            auto* table = new IntrusiveSideTable(bits_ >> 1);
+            bits_ = reinterpret_cast<uintptr_t>(table) | 1;
+        }
+        return GetTable();
+    }
+
+    bool HasSideTable() const {
+        return (bits_ & 1) != 0;
+    }
+
+private:
+    IntrusiveSideTable* GetTable() const {
+        return reinterpret_cast<IntrusiveSideTable*>(bits_ & ~uintptr_t(1));
+    }
+
+    uintptr_t bits_ = 0;
+};
+
+// `SimpleRefCounted` which can also be observed by `IntrusiveWeakPtr`
+template <typename Derived, typename D = DefaultDelete>
+using WeakRefCounted = RefCounted<Derived, SideTableCounter, D>;
+
+// `WeakPtr` for `WeakRefCounted` objects, Swift style: it references the side table, never a
+// control block, and the object is destroyed as soon as the last strong reference goes away
+template <typename T>
+class IntrusiveWeakPtr {
+    template <typename Y>
+    friend class IntrusiveWeakPtr;
+
+    T* ptr_;
+    IntrusiveSideTable* table_;
+
+    void IncrementWeakCounter() {
+        if (table_ != nullptr) {
+            table_->IncWeak();
+        }
+    }
+
+    void DecrementWeakCounter() {
+        if (table_ != nullptr) {
+            table_->DecWeak();
+        }
+    }
+
+public:
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Constructors
+
+    IntrusiveWeakPtr() : ptr_(nullptr), table_(nullptr) {
+    }
+
+    template <typename Y>
+    IntrusiveWeakPtr(const IntrusivePtr<Y>& other) : ptr_(other.Get()), table_(nullptr) {
+        if (ptr_ != nullptr) {
+            table_ = other->GetCounter().GetSideTable();
+            IncrementWeakCounter();
+        }
+    }
+
+    IntrusiveWeakPtr(const IntrusiveWeakPtr& other) : ptr_(other.ptr_), table_(other.table_) {
+        IncrementWeakCounter();
+    }
+
+    template <typename Y>
+    IntrusiveWeakPtr(const IntrusiveWeakPtr<Y>& other) : ptr_(other.ptr_), table_(other.table_) {
+        IncrementWeakCounter();
+    }
+
+    IntrusiveWeakPtr(IntrusiveWeakPtr&& other)
+        : ptr_(std::exchange(other.ptr_, nullptr)), table_(std::exchange(other.table_, nullptr)) {
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // `operator=`-s
+
+    IntrusiveWeakPtr& operator=(const IntrusiveWeakPtr& other) {
+        if (this == &other) {
+            return *this;
+        }
+        IntrusiveWeakPtr(other).Swap(*this);
+        return *this;
+    }
+
+    IntrusiveWeakPtr& operator=(IntrusiveWeakPtr&& other) {
+        if (this == &other) {
+            return *this;
+        }
+        IntrusiveWeakPtr(std::move(other)).Swap(*this);
+        return *this;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Destructor
+
+    ~IntrusiveWeakPtr() {
+        DecrementWeakCounter();
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Modifiers
+
+    void Reset() {
+        DecrementWeakCounter();
+        ptr_ = nullptr;
+        table_ = nullptr;
+    }
+
+    void Swap(IntrusiveWeakPtr& other) {
+        std::swap(ptr_, other.ptr_);
+        std::swap(table_, other.table_);
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Observers
+
+    size_t UseCount() const {
+        if (table_ == nullptr) {
+            return 0;
+        }
+        return table_->RefCount();
+    }
+    bool Expired() const {
+        return UseCount() == 0;
+    }
+    IntrusivePtr<T> Lock() const {
+        if (Expired()) {
+            return nullptr;
+        }
+        return IntrusivePtr<T>(ptr_);
+    }
+};
@@ -0,0 +1,209 @@
+#pragma once
+
+#include <sys/mman.h>
+
+#include <cstddef>  // size_t
+#include <limits>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "shared.h"
+#include "unique.h"
+
+// Objects and arrays at least this big bypass malloc: they get their own mapping, which is
+// returned to the OS as soon as the owner releases it
+inline constexpr size_t kDirectMmapThreshold = size_t{1} << 20;
+
+inline void* MapAnonymous(size_t bytes) {
+    void* memory =
+        mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) {
+        throw std::bad_alloc();
+    }
+    return memory;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Deleters
+
+// `length` is the size of the mapping; 0 means the pointer came from plain `new`
+template <typename T>
+class MunmapDeleter {
+public:
+    MunmapDeleter() = default;
+
+    explicit MunmapDeleter(size_t length) : length_(length) {
+    }
+
+    void operator()(T* ptr) {
+        if (ptr == nullptr) {
+            return;
+        }
+        if (length_ == 0) {
+            delete ptr;
+            return;
+        }
+        ptr->~T();
+        munmap(const_cast<std::remove_const_t<T>*>(ptr), length_);
+    }
+
+    size_t GetLength() const {
+        return length_;
+    }
+
+private:
+    size_t length_ = 0;
+};
+
+template <typename T>
+class MunmapDeleter<T[]> {
+public:
+    MunmapDeleter() = default;
+
+    MunmapDeleter(size_t size, size_t length) : size_(size), length_(length) {
+    }
+
+    void operator()(T* ptr) {
+        if (ptr == nullptr) {
+            return;
+        }
+        if (length_ == 0) {
+            delete[] ptr;
+            return;
+        }
+        if constexpr (!std::is_trivially_destructible_v<T>) {
+            for (size_t i = size_; i > 0; --i) {
+                ptr[i - 1].~T();
+            }
+        }
+        munmap(const_cast<std::remove_const_t<T>*>(ptr), length_);
+    }
+
+    size_t GetSize() const {
+        return size_;
+    }
+
+    size_t GetLength() const {
+        return length_;
+    }
+
+private:
+    size_t size_ = 0;
+    size_t length_ = 0;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Control block
+
+// Only this small header stays on the heap; the mapping is dropped with the last strong reference
+// even if weak references keep the header alive
+template <typename T>
+class MappedControlBlock : public ControlBlockBase {
+public:
+    MappedControlBlock(T* ptr, size_t length) : ptr_(ptr), length_(length) {
+        strong_counter = 1;
+    }
+
+    void DeletePointer() override {
+        ptr_->~T();
+        munmap(const_cast<std::remove_const_t<T>*>(ptr_), length_);
+    }
+
+    T* GetPointer() const {
+        return ptr_;
+    }
+
+private:
+    T* ptr_;
+    size_t length_;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Factories
+
+template <typename T, typename... Args>
+std::enable_if_t<!std::is_array_v<T>, SharedPtr<T>> MakeSharedLarge(Args&&... args) {
+    if constexpr (sizeof(T) < kDirectMmapThreshold) {
+        return MakeShared<T>(std::forward<Args>(args)...);
+    } else {
+        void* memory = MapAnonymous(sizeof(T));
+        T* ptr;
+        try {
+            ptr = new (memory) T(std::forward<Args>(args)...);
+        } catch (...) {
+            munmap(memory, sizeof(T));
+            throw;
+        }
+        ControlBlockBase* block;
+        try {
+            block = new MappedControlBlock<T>(ptr, sizeof(T));
+        } catch (...) {
+            ptr->~T();
+            munmap(memory, sizeof(T));
+            throw;
+        }
+        return SharedPtr<T>(block, ptr);
+    }
+}
+
+template <typename T, typename... Args>
+std::enable_if_t<!std::is_array_v<T>, UniquePtr<T, MunmapDeleter<T>>> MakeUniqueLarge(
+    Args&&... args) {
+    if constexpr (sizeof(T) < kDirectMmapThreshold) {
+        return UniquePtr<T, MunmapDeleter<T>>(new T(std::forward<Args>(args)...));
+    } else {
+        void* memory = MapAnonymous(sizeof(T));
+        try {
+            return UniquePtr<T, MunmapDeleter<T>>(new (memory) T(std::forward<Args>(args)...),
+                                                  MunmapDeleter<T>(sizeof(T)));
+        } catch (...) {
+            munmap(memory, sizeof(T));
+            throw;
+        }
+    }
+}
+
+template <typename T>
+std::enable_if_t<std::is_unbounded_array_v<T>, UniquePtr<T, MunmapDeleter<T>>> MakeUniqueLarge(
+    size_t size) {
+    using Element = std::remove_extent_t<T>;
+    if (size > std::numeric_limits<size_t>::max() / sizeof(Element)) {
+        throw std::bad_array_new_length();
+    }
+    size_t length = sizeof(Element) * size;
+    if (length < kDirectMmapThreshold) {
+        return UniquePtr<T, MunmapDeleter<T>>(new Element[size](), MunmapDeleter<T>(size, 0));
+    }
+
+    // Fresh anonymous pages are already zeroed, trivial types need no initialization pass
+    auto* ptr = static_cast<Element*>(MapAnonymous(length));
+    if constexpr (!std::is_trivially_default_constructible_v<Element>) {
+        size_t constructed = 0;
+        try {
+            for (; constructed < size; ++constructed) {
+                new (ptr + constructed) Element();
+            }
+        } catch (...) {
+            while (constructed > 0) {
+                ptr[--constructed].~Element();
+            }
+            munmap(ptr, length);
+            throw;
+        }
+    }
+    return UniquePtr<T, MunmapDeleter<T>>(ptr, MunmapDeleter<T>(size, length));
+}
+
+// Shared owner of the first element of a value-initialized array; a large one is unmapped with
+// the last strong reference
+template <typename T>
+std::enable_if_t<std::is_unbounded_array_v<T>, SharedPtr<std::remove_extent_t<T>>>
+MakeSharedLarge(size_t size) {
+    using Element = std::remove_extent_t<T>;
+    auto array = MakeUniqueLarge<T>(size);
+    auto* block = new ControlBlockPointerDeleter<Element, MunmapDeleter<T>>(
+        array.Get(), std::move(array.GetDeleter()));
+    Element* ptr = array.Release();
+    return SharedPtr<Element>(block, ptr);
+}
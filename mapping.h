@@ -0,0 +1,223 @@
+#pragma once
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>  // size_t
+#include <cstdint>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <type_traits>
+
+#include "large_alloc.h"  // MunmapDeleter
+#include "shared.h"
+#include "unique.h"
+
+enum class MappingMode {
+    kReadOnly,
+    kReadWrite,
+};
+
+namespace mapping_detail {
+
+template <typename T>
+void* PageStart(T* ptr) {
+    static const auto page_size = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+    auto address = reinterpret_cast<uintptr_t>(ptr);
+    return reinterpret_cast<void*>(address / page_size * page_size);
+}
+
+// madvise wants a page aligned start, so the range is widened down to the page boundary
+template <typename T>
+void Advise(T* ptr, size_t count, int advice) {
+    if (ptr == nullptr || count == 0) {
+        return;
+    }
+    void* start = PageStart(ptr);
+    auto* end = reinterpret_cast<const char*>(ptr + count);
+    madvise(start, end - static_cast<const char*>(start), advice);
+}
+
+}  // namespace mapping_detail
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// SharedMapping
+
+// Reference counted view of a mapping; slices share the mapping through the aliasing constructor
+template <typename T>
+class SharedMapping {
+public:
+    SharedMapping() = default;
+
+    SharedMapping(SharedPtr<T> data, size_t size) : data_(std::move(data)), size_(size) {
+    }
+
+    SharedMapping Slice(size_t offset, size_t count) const {
+        if (offset > size_ || count > size_ - offset) {
+            throw std::out_of_range("SharedMapping::Slice");
+        }
+        return SharedMapping(SharedPtr<T>(data_, data_.Get() + offset), count);
+    }
+
+    void WillNeed() const {
+        mapping_detail::Advise(Get(), size_, MADV_WILLNEED);
+    }
+
+    void DontNeed() const {
+        mapping_detail::Advise(Get(), size_, MADV_DONTNEED);
+    }
+
+    T* Get() const {
+        return data_.Get();
+    }
+
+    size_t Size() const {
+        return size_;
+    }
+
+    std::span<T> Span() const {
+        return std::span<T>(Get(), size_);
+    }
+
+    T& operator[](size_t i) const {
+        return Get()[i];
+    }
+
+    size_t UseCount() const {
+        return data_.UseCount();
+    }
+
+private:
+    SharedPtr<T> data_;
+    size_t size_ = 0;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// UniqueMapping
+
+// File mapped as an array of `T`. Use `const T` for read-only mappings.
+template <typename T>
+class UniqueMapping {
+    static_assert(std::is_trivially_copyable_v<T>, "Mapped data must be trivially copyable");
+
+public:
+    using Storage = UniquePtr<T[], MunmapDeleter<T[]>>;
+
+    UniqueMapping() = default;
+
+    explicit UniqueMapping(Storage data) : data_(std::move(data)) {
+    }
+
+    // Throws std::system_error if the file cannot be opened or mapped. Trailing bytes that do not
+    // form a whole `T` are left out.
+    static UniqueMapping Open(const std::string& path, MappingMode mode = MappingMode::kReadOnly) {
+        bool writable = mode == MappingMode::kReadWrite;
+        if (writable && std::is_const_v<T>) {
+            throw std::system_error(EINVAL, std::generic_category(), path);
+        }
+
+        int fd = open(path.c_str(), (writable ? O_RDWR : O_RDONLY) | O_CLOEXEC);
+        if (fd < 0) {
+            throw std::system_error(errno, std::generic_category(), path);
+        }
+        struct stat info;
+        if (fstat(fd, &info) != 0) {
+            int error = errno;
+            close(fd);
+            throw std::system_error(error, std::generic_category(), path);
+        }
+
+        size_t size = static_cast<size_t>(info.st_size) / sizeof(T);
+        if (size == 0) {
+            close(fd);
+            return UniqueMapping();
+        }
+        size_t length = size * sizeof(T);
+        void* memory =
+            mmap(nullptr, length, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0);
+        int error = errno;
+        close(fd);  // the mapping keeps its own reference to the file
+        if (memory == MAP_FAILED) {
+            throw std::system_error(error, std::generic_category(), path);
+        }
+        return UniqueMapping(Storage(static_cast<T*>(memory), MunmapDeleter<T[]>(size, length)));
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Access pattern hints
+
+    void WillNeed() const {
+        mapping_detail::Advise(Get(), Size(), MADV_WILLNEED);
+    }
+
+    void Sequential() const {
+        mapping_detail::Advise(Get(), Size(), MADV_SEQUENTIAL);
+    }
+
+    void Random() const {
+        mapping_detail::Advise(Get(), Size(), MADV_RANDOM);
+    }
+
+    void DontNeed() const {
+        mapping_detail::Advise(Get(), Size(), MADV_DONTNEED);
+    }
+
+    // Starts reading `[offset, offset + count)` in ahead of use
+    void Prefetch(size_t offset, size_t count) const {
+        if (offset >= Size()) {
+            return;
+        }
+        mapping_detail::Advise(Get() + offset, std::min(count, Size() - offset), MADV_WILLNEED);
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Modifiers
+
+    // Hands the mapping over to reference counted owners
+    SharedMapping<T> Share() && {
+        size_t size = Size();
+        if (!data_) {
+            return SharedMapping<T>();
+        }
+        auto* block = new ControlBlockPointerDeleter<T, MunmapDeleter<T[]>>(
+            data_.Get(), std::move(data_.GetDeleter()));
+        T* ptr = data_.Release();
+        return SharedMapping<T>(SharedPtr<T>(block, ptr), size);
+    }
+
+    void Reset() {
+        data_.Reset();
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Observers
+
+    T* Get() const {
+        return data_.Get();
+    }
+
+    size_t Size() const {
+        return data_ ? data_.GetDeleter().GetSize() : 0;
+    }
+
+    std::span<T> Span() const {
+        return std::span<T>(Get(), Size());
+    }
+
+    T& operator[](size_t i) const {
+        return Get()[i];
+    }
+
+    explicit operator bool() const {
+        return static_cast<bool>(data_);
+    }
+
+private:
+    Storage data_;
+};
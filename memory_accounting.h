@@ -0,0 +1,216 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>  // size_t
+#include <cstdint>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+#include "shared.h"
+#include "unique.h"
+
+// Subsystem / tenant the allocation is charged to. Category 0 is "untagged".
+struct MemoryCategory {
+    static constexpr uint32_t kMaxCategories = 64;
+
+    // Throws std::out_of_range (a compile error for `constexpr` categories) if `id` is too large
+    constexpr explicit MemoryCategory(uint32_t id = 0) : id(id) {
+        if (id >= kMaxCategories) {
+            throw std::out_of_range("MemoryCategory id");
+        }
+    }
+
+    uint32_t id;
+};
+
+struct MemoryUsage {
+    int64_t current_bytes = 0;
+    // Highest `current_bytes` returned by `GetUsage` so far. This is a sampled value, not a true
+    // peak: usage that rises and falls back between two reads does not show up here.
+    int64_t sampled_peak_bytes = 0;
+};
+
+// Writers only touch counters of their own thread (a relaxed load + store, no locked RMW).
+// Readers take the registry lock and sum the counters of all live and exited threads.
+class MemoryAccounting {
+public:
+    static constexpr size_t kMaxCategories = MemoryCategory::kMaxCategories;
+
+    static void Charge(MemoryCategory category, size_t bytes) {
+        Local().Add(category.id, static_cast<int64_t>(bytes));
+    }
+
+    static void Credit(MemoryCategory category, size_t bytes) {
+        Local().Add(category.id, -static_cast<int64_t>(bytes));
+    }
+
+    static MemoryUsage GetUsage(MemoryCategory category) {
+        Registry& registry = GetRegistry();
+        std::lock_guard lock(registry.mutex);
+        int64_t current = registry.retired[category.id];
+        for (const ThreadCounters* counters : registry.threads) {
+            current += counters->bytes[category.id].load(std::memory_order_relaxed);
+        }
+        registry.peak[category.id] = std::max(registry.peak[category.id], current);
+        return {current, registry.peak[category.id]};
+    }
+
+private:
+    struct ThreadCounters;
+
+    struct Registry {
+        std::mutex mutex;
+        std::vector<ThreadCounters*> threads;
+        int64_t retired[kMaxCategories] = {};
+        int64_t peak[kMaxCategories] = {};
+    };
+
+    struct ThreadCounters {
+        ThreadCounters() {
+            Registry& registry = GetRegistry();
+            std::lock_guard lock(registry.mutex);
+            registry.threads.push_back(this);
+        }
+
+        ~ThreadCounters() {
+            Registry& registry = GetRegistry();
+            std::lock_guard lock(registry.mutex);
+            for (size_t i = 0; i < kMaxCategories; ++i) {
+                registry.retired[i] += bytes[i].load(std::memory_order_relaxed);
+            }
+            std::erase(registry.threads, this);
+        }
+
+        void Add(uint32_t category, int64_t delta) {
+            auto& counter = bytes[category];
+            counter.store(counter.load(std::memory_order_relaxed) + delta,
+                          std::memory_order_relaxed);
+        }
+
+        std::atomic<int64_t> bytes[kMaxCategories] = {};
+    };
+
+    static Registry& GetRegistry() {
+        static Registry registry;
+        return registry;
+    }
+
+    static ThreadCounters& Local() {
+        thread_local ThreadCounters counters;
+        return counters;
+    }
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// SharedPtr support
+
+// Charges the whole block (counters + object) to `category` for as long as the block exists
+template <typename T>
+class AccountedControlBlockHolder : public ControlBlockHolder<T> {
+public:
+    template <typename... Args>
+    AccountedControlBlockHolder(MemoryCategory category, Args&&... args)
+        : ControlBlockHolder<T>(std::forward<Args>(args)...), category_(category) {
+        MemoryAccounting::Charge(category_, sizeof(*this));
+    }
+
+    ~AccountedControlBlockHolder() override {
+        MemoryAccounting::Credit(category_, sizeof(*this));
+    }
+
+private:
+    MemoryCategory category_;
+};
+
+template <typename T, typename... Args>
+SharedPtr<T> MakeShared(MemoryCategory category, Args&&... args) {
+    ControlBlockHolder<T>* block =
+        new AccountedControlBlockHolder<T>(category, std::forward<Args>(args)...);
+    return SharedPtr<T>(block);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// UniquePtr support
+
+// Credits the byte count that was charged, so converting `UniquePtr<Derived>` to
+// `UniquePtr<Base>` still credits `sizeof(Derived)`
+template <typename T>
+class AccountedDeleter {
+public:
+    AccountedDeleter() = default;
+
+    explicit AccountedDeleter(MemoryCategory category, size_t bytes = sizeof(T))
+        : category_(category), bytes_(bytes) {
+    }
+
+    template <typename ChildType>
+    AccountedDeleter(AccountedDeleter<ChildType>&& other)
+        : category_(other.GetCategory()), bytes_(other.GetBytes()) {
+    }
+
+    void operator()(T* ptr) {
+        if (ptr == nullptr) {
+            return;
+        }
+        delete ptr;
+        MemoryAccounting::Credit(category_, bytes_);
+    }
+
+    MemoryCategory GetCategory() const {
+        return category_;
+    }
+
+    size_t GetBytes() const {
+        return bytes_;
+    }
+
+private:
+    MemoryCategory category_;
+    size_t bytes_ = sizeof(T);
+};
+
+template <typename T>
+class AccountedDeleter<T[]> {
+public:
+    AccountedDeleter() = default;
+
+    AccountedDeleter(MemoryCategory category, size_t size) : category_(category), size_(size) {
+    }
+
+    void operator()(T* ptr) {
+        if (ptr == nullptr) {
+            return;
+        }
+        delete[] ptr;
+        MemoryAccounting::Credit(category_, sizeof(T) * size_);
+    }
+
+    MemoryCategory GetCategory() const {
+        return category_;
+    }
+
+private:
+    MemoryCategory category_;
+    size_t size_ = 0;
+};
+
+template <typename T, typename... Args>
+std::enable_if_t<!std::is_array_v<T>, UniquePtr<T, AccountedDeleter<T>>> MakeUnique(
+    MemoryCategory category, Args&&... args) {
+    UniquePtr<T, AccountedDeleter<T>> ptr(new T(std::forward<Args>(args)...),
+                                          AccountedDeleter<T>(category));
+    MemoryAccounting::Charge(category, sizeof(T));
+    return ptr;
+}
+
+template <typename T>
+std::enable_if_t<std::is_unbounded_array_v<T>, UniquePtr<T, AccountedDeleter<T>>> MakeUnique(
+    MemoryCategory category, size_t size) {
+    using Element = std::remove_extent_t<T>;
+    UniquePtr<T, AccountedDeleter<T>> ptr(new Element[size](),
+                                          AccountedDeleter<T>(category, size));
+    MemoryAccounting::Charge(category, sizeof(Element) * size);
+    return ptr;
+}
@@ -0,0 +1,650 @@
+#pragma once
+
+#include <array>
+#include <bit>
+#include <cstddef>  // size_t
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "shared.h"
+
+// Persistent (immutable, structurally shared) containers. Every update returns a new container
+// which shares all untouched nodes with the old one; only the O(log n) path to the change is
+// copied. Nodes are `SharedPtr<..., NoWeak>`, so a node with `UseCount() == 1` belongs to a single
+// container and may be changed in place: that is what the transient versions do for batches.
+//     PersistentVector<int> snapshot = ...;
+//     auto batch = snapshot.Transient();
+//     for (...) batch.PushBack(x);            // copies each shared node at most once
+//     PersistentVector<int> next = std::move(batch).Persistent();
+// Like the pointers themselves the containers are not thread-safe: node counts are plain `int`s
+// and transients decide whether to copy a node by its `UseCount()`, so handing versions that share
+// nodes to other threads is a data race.
+
+namespace persistent_detail {
+
+inline constexpr int kBits = 5;
+inline constexpr size_t kBranching = size_t(1) << kBits;
+inline constexpr size_t kMask = kBranching - 1;
+
+template <typename Node>
+using NodePtr = SharedPtr<Node, NoWeak>;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// 32-way radix trie
+
+struct VectorNode {};
+
+template <typename T>
+struct VectorLeaf : VectorNode {
+    std::array<T, kBranching> values{};
+};
+
+struct VectorBranch : VectorNode {
+    std::array<NodePtr<VectorNode>, kBranching> children;
+};
+
+// Leaves sit at level 0, the root at level `shift_`. Index bits `[level, level + kBits)` pick the
+// child at each level.
+template <typename T>
+class VectorTrie {
+    using Leaf = VectorLeaf<T>;
+    using Branch = VectorBranch;
+    using Ptr = NodePtr<VectorNode>;
+
+public:
+    VectorTrie() = default;
+
+    VectorTrie(const VectorTrie&) = default;
+    VectorTrie& operator=(const VectorTrie&) = default;
+
+    // The source is left empty, not with a null root under its old size
+    VectorTrie(VectorTrie&& other)
+        : root_(std::move(other.root_)),
+          shift_(std::exchange(other.shift_, 0)),
+          size_(std::exchange(other.size_, 0)) {
+    }
+
+    VectorTrie& operator=(VectorTrie&& other) {
+        if (this != &other) {
+            root_ = std::move(other.root_);
+            shift_ = std::exchange(other.shift_, 0);
+            size_ = std::exchange(other.size_, 0);
+        }
+        return *this;
+    }
+
+    size_t Size() const {
+        return size_;
+    }
+
+    const T& Get(size_t index) const {
+        const VectorNode* node = root_.Get();
+        for (int level = shift_; level > 0; level -= kBits) {
+            node = static_cast<const Branch*>(node)->children[(index >> level) & kMask].Get();
+        }
+        return static_cast<const Leaf*>(node)->values[index & kMask];
+    }
+
+    void Set(size_t index, T value) {
+        MutableLeaf(index).values[index & kMask] = std::move(value);
+    }
+
+    void PushBack(T value) {
+        if (root_ && size_ == (kBranching << shift_)) {
+            auto branch = MakeSharedNoWeak<Branch>();
+            branch->children[0] = std::move(root_);
+            root_ = std::move(branch);
+            shift_ += kBits;
+        }
+        MutableLeaf(size_).values[size_ & kMask] = std::move(value);
+        ++size_;
+    }
+
+    void PopBack() {
+        --size_;
+        if (size_ == 0) {
+            root_.Reset();
+            shift_ = 0;
+            return;
+        }
+        MutableLeaf(size_).values[size_ & kMask] = T();
+
+        // The largest subtree starting at index `size_` is now empty
+        Ptr* slot = &root_;
+        for (int level = shift_; level > 0; level -= kBits) {
+            Ptr& child = AsBranch(*slot)->children[(size_ >> level) & kMask];
+            if ((size_ & ((size_t(1) << level) - 1)) == 0) {
+                child.Reset();
+                break;
+            }
+            slot = &child;
+        }
+        while (shift_ > 0 && size_ <= (size_t(1) << shift_)) {
+            Ptr only_child = AsBranch(root_)->children[0];
+            root_ = std::move(only_child);
+            shift_ -= kBits;
+        }
+    }
+
+private:
+    static Leaf* AsLeaf(const Ptr& node) {
+        return static_cast<Leaf*>(node.Get());
+    }
+
+    static Branch* AsBranch(const Ptr& node) {
+        return static_cast<Branch*>(node.Get());
+    }
+
+    // Copies the node at `level` if anybody else references it
+    static void EnsureUnique(Ptr& node, int level) {
+        if (node.UseCount() == 1) {
+            return;
+        }
+        if (level == 0) {
+            node = MakeSharedNoWeak<Leaf>(*AsLeaf(node));
+        } else {
+            node = MakeSharedNoWeak<Branch>(*AsBranch(node));
+        }
+    }
+
+    // Leaf holding `index`, with the whole path to it unique; missing nodes are created
+    Leaf& MutableLeaf(size_t index) {
+        Ptr* slot = &root_;
+        for (int level = shift_;; level -= kBits) {
+            if (!*slot) {
+                if (level == 0) {
+                    *slot = MakeSharedNoWeak<Leaf>();
+                } else {
+                    *slot = MakeSharedNoWeak<Branch>();
+                }
+            } else {
+                EnsureUnique(*slot, level);
+            }
+            if (level == 0) {
+                return *AsLeaf(*slot);
+            }
+            slot = &AsBranch(*slot)->children[(index >> level) & kMask];
+        }
+    }
+
+    Ptr root_;
+    int shift_ = 0;
+    size_t size_ = 0;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Hash array mapped trie, CHAMP layout (Steindorfer, Vinju, OOPSLA 2015): inline entries and
+// child nodes are kept in two compact arrays indexed through their own bitmaps
+
+template <typename K, typename V>
+struct MapNode {
+    uint32_t datamap = 0;
+    uint32_t nodemap = 0;
+    std::vector<std::pair<K, V>> entries;
+    std::vector<NodePtr<MapNode>> children;
+};
+
+template <typename K, typename V, typename Hash, typename Equal>
+class HashTrie {
+    using Node = MapNode<K, V>;
+    using Ptr = NodePtr<Node>;
+
+    // Below this every hash bit has been used: nodes hold colliding keys in a plain list
+    static constexpr int kHashBits = sizeof(size_t) * 8;
+
+public:
+    HashTrie() = default;
+
+    HashTrie(const HashTrie&) = default;
+    HashTrie& operator=(const HashTrie&) = default;
+
+    // The source is left empty, see `VectorTrie`
+    HashTrie(HashTrie&& other)
+        : root_(std::move(other.root_)),
+          size_(std::exchange(other.size_, 0)),
+          hash_(std::move(other.hash_)),
+          equal_(std::move(other.equal_)) {
+    }
+
+    HashTrie& operator=(HashTrie&& other) {
+        if (this != &other) {
+            root_ = std::move(other.root_);
+            size_ = std::exchange(other.size_, 0);
+            hash_ = std::move(other.hash_);
+            equal_ = std::move(other.equal_);
+        }
+        return *this;
+    }
+
+    size_t Size() const {
+        return size_;
+    }
+
+    const V* Find(const K& key) const {
+        size_t hash = hash_(key);
+        const Node* node = root_.Get();
+        for (int shift = 0; node != nullptr; shift += kBits) {
+            if (shift >= kHashBits) {
+                for (const auto& entry : node->entries) {
+                    if (equal_(entry.first, key)) {
+                        return &entry.second;
+                    }
+                }
+                return nullptr;
+            }
+            uint32_t bit = Bit(hash, shift);
+            if (node->datamap & bit) {
+                const auto& entry = node->entries[Index(node->datamap, bit)];
+                return equal_(entry.first, key) ? &entry.second : nullptr;
+            }
+            if (!(node->nodemap & bit)) {
+                return nullptr;
+            }
+            node = node->children[Index(node->nodemap, bit)].Get();
+        }
+        return nullptr;
+    }
+
+    // Inserts or assigns; returns whether the key is new
+    bool Set(K key, V value) {
+        if (!root_) {
+            root_ = MakeSharedNoWeak<Node>();
+        }
+        size_t hash = hash_(key);
+        bool inserted = Set(root_, hash, 0, std::move(key), std::move(value));
+        size_ += inserted ? 1 : 0;
+        return inserted;
+    }
+
+    bool Erase(const K& key) {
+        if (Find(key) == nullptr) {
+            return false;  // nothing to copy
+        }
+        Erase(root_, hash_(key), 0, key);
+        --size_;
+        return true;
+    }
+
+    template <typename Function>
+    void ForEach(Function&& function) const {
+        if (root_) {
+            ForEach(*root_, function);
+        }
+    }
+
+private:
+    static uint32_t Bit(size_t hash, int shift) {
+        return uint32_t(1) << ((hash >> shift) & kMask);
+    }
+
+    static size_t Index(uint32_t bitmap, uint32_t bit) {
+        return std::popcount(bitmap & (bit - 1));
+    }
+
+    static void EnsureUnique(Ptr& node) {
+        if (node.UseCount() > 1) {
+            node = MakeSharedNoWeak<Node>(*node);
+        }
+    }
+
+    bool Set(Ptr& slot, size_t hash, int shift, K key, V value) {
+        EnsureUnique(slot);
+        Node& node = *slot;
+        if (shift >= kHashBits) {
+            for (auto& entry : node.entries) {
+                if (equal_(entry.first, key)) {
+                    entry.second = std::move(value);
+                    return false;
+                }
+            }
+            node.entries.emplace_back(std::move(key), std::move(value));
+            return true;
+        }
+
+        uint32_t bit = Bit(hash, shift);
+        if (node.nodemap & bit) {
+            return Set(node.children[Index(node.nodemap, bit)], hash, shift + kBits,
+                       std::move(key), std::move(value));
+        }
+        size_t index = Index(node.datamap, bit);
+        if (!(node.datamap & bit)) {
+            node.entries.emplace(node.entries.begin() + index, std::move(key), std::move(value));
+            node.datamap |= bit;
+            return true;
+        }
+        if (equal_(node.entries[index].first, key)) {
+            node.entries[index].second = std::move(value);
+            return false;
+        }
+
+        // Two keys share this slot: push both one level down
+        std::pair<K, V> existing = std::move(node.entries[index]);
+        node.entries.erase(node.entries.begin() + index);
+        node.datamap ^= bit;
+        Ptr child = MakeSharedNoWeak<Node>();
+        size_t existing_hash = hash_(existing.first);
+        Set(child, existing_hash, shift + kBits, std::move(existing.first),
+            std::move(existing.second));
+        Set(child, hash, shift + kBits, std::move(key), std::move(value));
+        node.children.insert(node.children.begin() + Index(node.nodemap, bit), std::move(child));
+        node.nodemap |= bit;
+        return true;
+    }
+
+    // `key` is known to be present
+    void Erase(Ptr& slot, size_t hash, int shift, const K& key) {
+        EnsureUnique(slot);
+        Node& node = *slot;
+        if (shift >= kHashBits) {
+            for (auto it = node.entries.begin(); it != node.entries.end(); ++it) {
+                if (equal_(it->first, key)) {
+                    node.entries.erase(it);
+                    return;
+                }
+            }
+            return;
+        }
+
+        uint32_t bit = Bit(hash, shift);
+        if (node.datamap & bit) {
+            node.entries.erase(node.entries.begin() + Index(node.datamap, bit));
+            node.datamap ^= bit;
+            return;
+        }
+        size_t child_index = Index(node.nodemap, bit);
+        Ptr& child = node.children[child_index];
+        Erase(child, hash, shift + kBits, key);
+        if (!child->children.empty() || child->entries.size() > 1) {
+            return;
+        }
+        // Keep the trie canonical: a child left with a single entry is folded into this node
+        std::pair<K, V> last = std::move(child->entries.front());
+        node.children.erase(node.children.begin() + child_index);
+        node.nodemap ^= bit;
+        node.entries.insert(node.entries.begin() + Index(node.datamap, bit), std::move(last));
+        node.datamap |= bit;
+    }
+
+    template <typename Function>
+    static void ForEach(const Node& node, Function& function) {
+        for (const auto& entry : node.entries) {
+            function(entry.first, entry.second);
+        }
+        for (const auto& child : node.children) {
+            ForEach(*child, function);
+        }
+    }
+
+    Ptr root_;
+    size_t size_ = 0;
+    [[no_unique_address]] Hash hash_;
+    [[no_unique_address]] Equal equal_;
+};
+
+}  // namespace persistent_detail
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// PersistentVector
+
+template <typename T>
+class PersistentVector;
+
+// Mutable version of `PersistentVector` for batches of updates. Nodes it already owns alone are
+// changed in place; nodes shared with other vectors are copied once.
+template <typename T>
+class TransientVector {
+public:
+    TransientVector() = default;
+
+    void PushBack(T value) {
+        trie_.PushBack(std::move(value));
+    }
+
+    void PopBack() {
+        if (Size() == 0) {
+            throw std::out_of_range("TransientVector::PopBack");
+        }
+        trie_.PopBack();
+    }
+
+    void Set(size_t index, T value) {
+        if (index >= Size()) {
+            throw std::out_of_range("TransientVector::Set");
+        }
+        trie_.Set(index, std::move(value));
+    }
+
+    const T& operator[](size_t index) const {
+        return trie_.Get(index);
+    }
+
+    size_t Size() const {
+        return trie_.Size();
+    }
+
+    PersistentVector<T> Persistent() && {
+        return PersistentVector<T>(std::move(trie_));
+    }
+
+private:
+    friend class PersistentVector<T>;
+
+    explicit TransientVector(persistent_detail::VectorTrie<T> trie) : trie_(std::move(trie)) {
+    }
+
+    persistent_detail::VectorTrie<T> trie_;
+};
+
+// Immutable vector, a 32-way radix trie: lookups and updates are O(log32 n).
+// `T` must be default constructible.
+template <typename T>
+class PersistentVector {
+public:
+    class Iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const T*;
+        using reference = const T&;
+
+        Iterator() = default;
+
+        Iterator(const PersistentVector* vector, size_t index) : vector_(vector), index_(index) {
+        }
+
+        const T& operator*() const {
+            return (*vector_)[index_];
+        }
+        const T* operator->() const {
+            return &(*vector_)[index_];
+        }
+        Iterator& operator++() {
+            ++index_;
+            return *this;
+        }
+        Iterator operator++(int) {
+            Iterator old = *this;
+            ++index_;
+            return old;
+        }
+        bool operator==(const Iterator& other) const {
+            return index_ == other.index_;
+        }
+
+    private:
+        const PersistentVector* vector_ = nullptr;
+        size_t index_ = 0;
+    };
+
+    PersistentVector() = default;
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Updates
+
+    PersistentVector PushBack(T value) const {
+        auto transient = Transient();
+        transient.PushBack(std::move(value));
+        return std::move(transient).Persistent();
+    }
+
+    PersistentVector PopBack() const {
+        if (Size() == 0) {
+            throw std::out_of_range("PersistentVector::PopBack");
+        }
+        auto transient = Transient();
+        transient.PopBack();
+        return std::move(transient).Persistent();
+    }
+
+    PersistentVector Set(size_t index, T value) const {
+        if (index >= Size()) {
+            throw std::out_of_range("PersistentVector::Set");
+        }
+        auto transient = Transient();
+        transient.Set(index, std::move(value));
+        return std::move(transient).Persistent();
+    }
+
+    TransientVector<T> Transient() const {
+        return TransientVector<T>(trie_);
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Observers
+
+    const T& operator[](size_t index) const {
+        return trie_.Get(index);
+    }
+    size_t Size() const {
+        return trie_.Size();
+    }
+    bool Empty() const {
+        return Size() == 0;
+    }
+    Iterator begin() const {
+        return Iterator(this, 0);
+    }
+    Iterator end() const {
+        return Iterator(this, Size());
+    }
+
+private:
+    friend class TransientVector<T>;
+
+    explicit PersistentVector(persistent_detail::VectorTrie<T> trie) : trie_(std::move(trie)) {
+    }
+
+    persistent_detail::VectorTrie<T> trie_;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// PersistentMap
+
+template <typename K, typename V, typename Hash, typename Equal>
+class PersistentMap;
+
+// Mutable version of `PersistentMap` for batches of updates, see `TransientVector`
+template <typename K, typename V, typename Hash = std::hash<K>, typename Equal = std::equal_to<K>>
+class TransientMap {
+public:
+    TransientMap() = default;
+
+    // Inserts or assigns; returns whether the key is new
+    bool Set(K key, V value) {
+        return trie_.Set(std::move(key), std::move(value));
+    }
+
+    bool Erase(const K& key) {
+        return trie_.Erase(key);
+    }
+
+    const V* Find(const K& key) const {
+        return trie_.Find(key);
+    }
+
+    size_t Size() const {
+        return trie_.Size();
+    }
+
+    PersistentMap<K, V, Hash, Equal> Persistent() && {
+        return PersistentMap<K, V, Hash, Equal>(std::move(trie_));
+    }
+
+private:
+    friend class PersistentMap<K, V, Hash, Equal>;
+
+    using Trie = persistent_detail::HashTrie<K, V, Hash, Equal>;
+
+    explicit TransientMap(Trie trie) : trie_(std::move(trie)) {
+    }
+
+    Trie trie_;
+};
+
+// Immutable hash map, a hash array mapped trie: lookups and updates are O(log32 n)
+template <typename K, typename V, typename Hash = std::hash<K>, typename Equal = std::equal_to<K>>
+class PersistentMap {
+public:
+    PersistentMap() = default;
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Updates
+
+    PersistentMap Set(K key, V value) const {
+        auto transient = Transient();
+        transient.Set(std::move(key), std::move(value));
+        return std::move(transient).Persistent();
+    }
+
+    // Erasing a missing key copies nothing
+    PersistentMap Erase(const K& key) const {
+        if (!Contains(key)) {
+            return *this;
+        }
+        auto transient = Transient();
+        transient.Erase(key);
+        return std::move(transient).Persistent();
+    }
+
+    TransientMap<K, V, Hash, Equal> Transient() const {
+        return TransientMap<K, V, Hash, Equal>(trie_);
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Observers
+
+    // nullptr if the key is missing
+    const V* Find(const K& key) const {
+        return trie_.Find(key);
+    }
+    bool Contains(const K& key) const {
+        return Find(key) != nullptr;
+    }
+    size_t Size() const {
+        return trie_.Size();
+    }
+    bool Empty() const {
+        return Size() == 0;
+    }
+
+    // Calls `function(key, value)` for every entry, in no particular order
+    template <typename Function>
+    void ForEach(Function&& function) const {
+        trie_.ForEach(function);
+    }
+
+private:
+    friend class TransientMap<K, V, Hash, Equal>;
+
+    using Trie = persistent_detail::HashTrie<K, V, Hash, Equal>;
+
+    explicit PersistentMap(Trie trie) : trie_(std::move(trie)) {
+    }
+
+    Trie trie_;
+};
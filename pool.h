@@ -0,0 +1,180 @@
+#pragma once
+
+#include <cstddef>  // size_t
+#include <functional>
+#include <vector>
+
+#include "shared.h"
+#include "unique.h"
+
+template <typename T>
+class ObjectPool;
+
+// Hands the object back to its pool instead of deleting it. Without a pool it is a plain `delete`.
+template <typename T>
+class PoolDeleter {
+public:
+    PoolDeleter() = default;
+
+    explicit PoolDeleter(ObjectPool<T>* pool) : pool_(pool) {
+    }
+
+    void operator()(T* ptr) {
+        if (ptr == nullptr) {
+            return;
+        }
+        if (pool_ == nullptr) {
+            delete ptr;
+            return;
+        }
+        pool_->Recycle(ptr);
+    }
+
+    ObjectPool<T>* GetPool() const {
+        return pool_;
+    }
+
+private:
+    ObjectPool<T>* pool_ = nullptr;
+};
+
+// Control block that returns the object and then itself to the pool
+template <typename T>
+class PoolControlBlock : public ControlBlockBase {
+public:
+    PoolControlBlock(ObjectPool<T>* pool, T* ptr) : pool_(pool), ptr_(ptr) {
+        strong_counter = 1;
+    }
+
+    void Rearm(T* ptr) {
+        ptr_ = ptr;
+        strong_counter = 1;
+        weak_counter = 0;
+    }
+
+    void DeletePointer() override {
+        pool_->Recycle(ptr_);
+    }
+
+    void DestroyBlock() override {
+        pool_->RecycleBlock(this);
+    }
+
+    T* GetPointer() const {
+        return ptr_;
+    }
+
+private:
+    ObjectPool<T>* pool_;
+    T* ptr_;
+};
+
+// Keeps up to `max_pooled` released objects (and control blocks) for reuse. Before an object goes
+// back it is passed to the reset hook, or to `T::Reset()` if there is no hook.
+//
+// Like the pointers themselves the pool is not thread-safe: use one pool per thread, e.g. a
+// `thread_local ObjectPool<T>`. The pool must outlive every pointer it handed out.
+template <typename T>
+class ObjectPool {
+    friend class PoolDeleter<T>;
+    friend class PoolControlBlock<T>;
+
+public:
+    using UniqueObject = UniquePtr<T, PoolDeleter<T>>;
+
+    explicit ObjectPool(size_t max_pooled = 1024, std::function<void(T&)> reset_hook = {})
+        : max_pooled_(max_pooled), reset_hook_(std::move(reset_hook)) {
+    }
+
+    ObjectPool(const ObjectPool&) = delete;
+    ObjectPool& operator=(const ObjectPool&) = delete;
+
+    ~ObjectPool() {
+        for (T* object : free_objects_) {
+            delete object;
+        }
+        for (PoolControlBlock<T>* block : free_blocks_) {
+            delete block;
+        }
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Acquiring
+
+    UniqueObject Acquire() {
+        return UniqueObject(TakeObject(), PoolDeleter<T>(this));
+    }
+
+    SharedPtr<T> AcquireShared() {
+        T* object = TakeObject();
+        PoolControlBlock<T>* block;
+        if (free_blocks_.empty()) {
+            try {
+                block = new PoolControlBlock<T>(this, object);
+            } catch (...) {
+                Recycle(object);
+                throw;
+            }
+        } else {
+            block = free_blocks_.back();
+            free_blocks_.pop_back();
+            block->Rearm(object);
+        }
+        return SharedPtr<T>(block, object);
+    }
+
+    // Constructs objects up front so that the first `count` acquisitions do not allocate
+    void Reserve(size_t count) {
+        while (free_objects_.size() < count && free_objects_.size() < max_pooled_) {
+            free_objects_.push_back(new T());
+        }
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Observers
+
+    size_t GetPooledCount() const {
+        return free_objects_.size();
+    }
+
+    size_t GetMaxPooled() const {
+        return max_pooled_;
+    }
+
+private:
+    T* TakeObject() {
+        if (free_objects_.empty()) {
+            return new T();
+        }
+        T* object = free_objects_.back();
+        free_objects_.pop_back();
+        return object;
+    }
+
+    void Recycle(T* object) {
+        if (free_objects_.size() >= max_pooled_) {
+            delete object;
+            return;
+        }
+        if (reset_hook_) {
+            reset_hook_(*object);
+        } else if constexpr (requires { object->Reset(); }) {
+            object->Reset();
+        }
+        free_objects_.push_back(object);
+    }
+
+    void RecycleBlock(PoolControlBlock<T>* block) {
+        if (free_blocks_.size() >= max_pooled_) {
+            delete block;
+            return;
+        }
+        free_blocks_.push_back(block);
+    }
+
+private:
+    size_t max_pooled_;
+    std::function<void(T&)> reset_hook_;
+    std::vector<T*> free_objects_;
+    std::vector<PoolControlBlock<T>*> free_blocks_;
+};
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <cstddef>  // std::nullptr_t
+#include <utility>
+
+#include "compressed_pair.h"
+
+// Smart pointer for objects which carry their own reference count, typically C library objects
+// with `ref()` / `unref()` functions. Traits describe the count:
+//     void Ref(T* ptr);                    // may be static; stateful traits are stored too
+//     void Unref(T* ptr);
+// There is no control block and, for stateless traits, the pointer is as small as `T*`.
+//     struct SslTraits {
+//         static void Ref(SSL* ssl) { SSL_up_ref(ssl); }
+//         static void Unref(SSL* ssl) { SSL_free(ssl); }
+//     };
+//     auto ssl = RetainPtr<SSL, SslTraits>::Adopt(SSL_new(ctx));  // takes over the +1 from SSL_new
+//     auto copy = RetainPtr<SSL, SslTraits>::Retain(borrowed);    // adds a reference of its own
+template <typename T, typename Traits>
+class RetainPtr {
+protected:
+    CompressedPair<T*, Traits> data_;
+
+    RetainPtr(T* ptr, Traits traits) noexcept : data_(ptr, std::move(traits)) {
+    }
+
+public:
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Constructors
+
+    RetainPtr() noexcept : data_(nullptr, Traits()) {
+    }
+
+    RetainPtr(std::nullptr_t) noexcept : RetainPtr() {
+    }
+
+    // Takes over a reference the caller already owns, e.g. the one returned by a `*_new()`
+    static RetainPtr Adopt(T* ptr, Traits traits = Traits()) noexcept {
+        return RetainPtr(ptr, std::move(traits));
+    }
+
+    // Adds a reference of its own to a borrowed pointer
+    static RetainPtr Retain(T* ptr, Traits traits = Traits()) {
+        if (ptr != nullptr) {
+            traits.Ref(ptr);
+        }
+        return RetainPtr(ptr, std::move(traits));
+    }
+
+    RetainPtr(const RetainPtr& other) : data_(other.Get(), other.GetTraits()) {
+        if (Get() != nullptr) {
+            GetTraits().Ref(Get());
+        }
+    }
+
+    RetainPtr(RetainPtr&& other) noexcept : data_(other.Release(), std::move(other.GetTraits())) {
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // `operator=`-s
+
+    RetainPtr& operator=(const RetainPtr& other) {
+        if (this == &other) {
+            return *this;
+        }
+        RetainPtr(other).Swap(*this);
+        return *this;
+    }
+
+    RetainPtr& operator=(RetainPtr&& other) noexcept {
+        if (this == &other) {
+            return *this;
+        }
+        RetainPtr(std::move(other)).Swap(*this);
+        return *this;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Destructor
+
+    ~RetainPtr() {
+        Reset();
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Modifiers
+
+    // Gives the reference back to the caller, e.g. to pass ownership into a C API
+    T* Release() noexcept {
+        T* ptr = Get();
+        data_.GetFirst() = nullptr;
+        return ptr;
+    }
+
+    void Reset() {
+        T* ptr = Release();
+        if (ptr != nullptr) {
+            GetTraits().Unref(ptr);
+        }
+    }
+
+    void Swap(RetainPtr& other) noexcept {
+        std::swap(data_.GetFirst(), other.data_.GetFirst());
+        std::swap(data_.GetSecond(), other.data_.GetSecond());
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Observers
+
+    T* Get() const noexcept {
+        return data_.GetFirst();
+    }
+    Traits& GetTraits() noexcept {
+        return data_.GetSecond();
+    }
+    const Traits& GetTraits() const noexcept {
+        return data_.GetSecond();
+    }
+    T& operator*() const {
+        return *Get();
+    }
+    T* operator->() const noexcept {
+        return Get();
+    }
+    explicit operator bool() const noexcept {
+        return Get() != nullptr;
+    }
+};
+
+template <typename T, typename Traits>
+bool operator==(const RetainPtr<T, Traits>& left, const RetainPtr<T, Traits>& right) {
+    return left.Get() == right.Get();
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstdio>
+#include <cstdlib>
+#include <type_traits>
+#include <utility>
+
+#include "shared.h"
+
+// Control block embedded in `ScopedShared`: the last reference destroys the object but leaves the
+// block itself to the enclosing scope
+template <typename T>
+class ScopedControlBlock : public ControlBlockHolder<T> {
+public:
+    template <typename... Args>
+    explicit ScopedControlBlock(Args&&... args)
+        : ControlBlockHolder<T>(std::forward<Args>(args)...) {
+    }
+
+    void DestroyBlock() override {
+    }
+};
+
+// Object and control block with automatic storage, for APIs that take a `SharedPtr` although the
+// object only lives for the duration of a call:
+//     ScopedShared<Request> request(...);
+//     Handle(request.Share());
+// Every `SharedPtr` / `WeakPtr` handed out must be gone when the scope ends. An escaped reference
+// would dangle, so the destructor aborts instead.
+template <typename T>
+class ScopedShared {
+public:
+    template <typename... Args>
+    explicit ScopedShared(Args&&... args)
+        : block_(std::forward<Args>(args)...), owner_(&block_, block_.GetPointer()) {
+    }
+
+    ScopedShared(const ScopedShared&) = delete;
+    ScopedShared& operator=(const ScopedShared&) = delete;
+
+    ~ScopedShared() {
+        if (block_.GetStrongCounter() != 1 || block_.GetWeakCounter() != kSelfWeakReferences) {
+            std::fputs("ScopedShared: a reference outlives its scope\n", stderr);
+            std::abort();
+        }
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Observers
+
+    SharedPtr<T> Share() const {
+        return owner_;
+    }
+
+    T* Get() const {
+        return owner_.Get();
+    }
+    T& operator*() const {
+        return *owner_;
+    }
+    T* operator->() const {
+        return owner_.Get();
+    }
+    size_t UseCount() const {
+        return owner_.UseCount();
+    }
+
+private:
+    // `EnableSharedFromThis::weak_this` observes the object for its whole life
+    static constexpr int kSelfWeakReferences =
+        std::is_convertible_v<T*, IEnableSharedFromThis*> ? 1 : 0;
+
+    ScopedControlBlock<T> block_;
+    SharedPtr<T> owner_;
+};
@@ -1,10 +1,16 @@
 #pragma once
 
 #include <cstddef>  // std::nullptr_t
+#include <functional>
 #include <iostream>
+#include <memory>
+#include <tuple>
 #include <type_traits>
+#include <utility>
+#include <vector>
 
 #include "sw_fwd.h"  // Forward declaration
+#include "unique.h"
 #include "weak.h"
 
 class IEnableSharedFromThis {};
@@ -33,25 +39,165 @@ public:
     WeakPtr<T> weak_this;
 };
 
-template <typename T, typename U>
-inline bool operator==(const SharedPtr<T>& left, const SharedPtr<U>& right) {
+// Deleter of an object which still lives in its control block (see `SharedPtr::TryUnwrap`).
+// The block keeps its single strong reference until the object is deleted through it;
+// without a block this is a plain `delete`.
+template <typename Policy = WithWeak>
+class ControlBlockDeleter {
+public:
+    using ControlBlock = typename Policy::ControlBlock;
+
+    ControlBlockDeleter() = default;
+
+    explicit ControlBlockDeleter(ControlBlock* block) : block_(block) {
+    }
+
+    ControlBlockDeleter(const ControlBlockDeleter&) = delete;
+
+    ControlBlockDeleter(ControlBlockDeleter&& other) noexcept : block_(other.block_) {
+        other.block_ = nullptr;
+    }
+
+    ControlBlockDeleter& operator=(const ControlBlockDeleter&) = delete;
+
+    ControlBlockDeleter& operator=(ControlBlockDeleter&& other) noexcept {
+        std::swap(block_, other.block_);
+        return *this;
+    }
+
+    template <typename T>
+    void operator()(T* ptr) {
+        if (ptr == nullptr) {
+            return;
+        }
+        if (block_ == nullptr) {
+            delete ptr;
+            return;
+        }
+        ControlBlock* block = block_;
+        block_ = nullptr;
+        block->DeletePointer();
+        block->DestroyBlock();
+    }
+
+    ControlBlock* GetBlock() const {
+        return block_;
+    }
+
+    // `UniquePtr::Release` leaves the block here; call this to take it over as well
+    ControlBlock* ReleaseBlock() {
+        ControlBlock* block = block_;
+        block_ = nullptr;
+        return block;
+    }
+
+private:
+    ControlBlock* block_ = nullptr;
+};
+
+template <typename T, typename TPolicy, typename U, typename UPolicy>
+inline bool operator==(const SharedPtr<T, TPolicy>& left, const SharedPtr<U, UPolicy>& right) {
     return left.Get() == right.Get();
 }
 
+template <typename T, typename Policy>
+class StdSharedKeepAlive;
+
 // https://en.cppreference.com/w/cpp/memory/shared_ptr
-template <typename T>
+// `Policy` is `WithWeak` (the default) or `NoWeak`, see sw_fwd.h
+template <typename T, typename Policy>
 class SharedPtr {
-    template <typename U>
+    template <typename U, typename OtherPolicy>
     friend class SharedPtr;
 
     template <typename U>
     friend class WeakPtr;
 
 public:
+    using ControlBlock = typename Policy::ControlBlock;
+
     T* ptr_;
-    ControlBlockBase* block_;
+    mutable ControlBlock* block_;  // may be replaced when a lazily adopted pointer is shared
 
 protected:
+    using Sentinel = SoleOwnerSentinel<T, ControlBlock>;
+
+    bool IsLazy() const {
+        return block_ != nullptr && block_->GetStrongCounter() == 0;
+    }
+
+    const Sentinel* GetSentinel() const {
+        return static_cast<const Sentinel*>(block_);
+    }
+
+    // Allocates the real block of a pointer adopted with `kLazyControlBlock`
+    ControlBlock* MaterializeBlock() const {
+        if (IsLazy()) {
+            block_ = GetSentinel()->CreateBlock(ptr_);
+        }
+        return block_;
+    }
+
+    template <typename U>
+    void AdoptLazily(U* ptr) {
+        if (ptr == nullptr) {
+            return;
+        }
+        using Mutable = std::remove_const_t<T>;
+        constexpr bool kDowncastable = requires(Mutable* base) { static_cast<U*>(base); };
+        if constexpr (std::is_convertible_v<U*, IEnableSharedFromThis*> || !kDowncastable) {
+            block_ = new ControlBlockPointer<U, ControlBlock>(ptr);
+            EnableSharedFromThisHook(ptr);
+        } else {
+            block_ = SoleOwnerSentinelFor<T, U, ControlBlock>::Get();
+        }
+    }
+
+    template <typename U>
+    void EnableSharedFromThisHook(U* ptr) {
+        if constexpr (std::is_convertible_v<U*, IEnableSharedFromThis*>) {
+            static_assert(Policy::kWeakReferences, "EnableSharedFromThis needs a weak counter");
+            if (ptr != nullptr) {
+                ptr->weak_this = *this;
+            }
+        }
+    }
+
+    bool IsUniqueOwner() const {
+        if (IsLazy()) {
+            return true;
+        }
+        if (block_ == nullptr || block_->GetStrongCounter() != 1) {
+            return false;
+        }
+        if constexpr (Policy::kWeakReferences) {
+            if (block_->GetWeakCounter() != 0) {
+                return false;
+            }
+        }
+        // An adopted `std::shared_ptr` may have owners outside this block
+        if (auto* std_block = dynamic_cast<ControlBlockStdShared<ControlBlock>*>(block_)) {
+            return std_block->GetOwner().use_count() == 1;
+        }
+        return true;
+    }
+
+    // Swaps the owned pointer of a `ControlBlockPointer<U>` nobody else references
+    template <typename U>
+    bool TryReusePointerBlock(U* ptr) {
+        if (!IsUniqueOwner()) {
+            return false;
+        }
+        auto* pointer_block = dynamic_cast<ControlBlockPointer<U, ControlBlock>*>(block_);
+        if (pointer_block == nullptr) {
+            return false;
+        }
+        pointer_block->DeletePointer();
+        pointer_block->ResetPointer(ptr);
+        ptr_ = ptr;
+        return true;
+    }
+
     void IncrementBlockStrongCounter() {
         if (block_ == nullptr) {
             return;
@@ -63,14 +209,26 @@ protected:
         if (block_ == nullptr) {
             return;
         }
-        if (block_->GetStrongCounter() == 1 && block_->GetWeakCounter() == 0) {
-            block_->DeletePointer();
-            delete block_;
+        if (IsLazy()) {
+            GetSentinel()->DeleteObject(ptr_);
             return;
         }
-        block_->DecrementStrongCounter();
-        if (block_->GetStrongCounter() <= 0) {
-            block_->DeletePointer();
+        if constexpr (Policy::kWeakReferences) {
+            if (block_->GetStrongCounter() == 1 && block_->GetWeakCounter() == 0) {
+                block_->DeletePointer();
+                block_->DestroyBlock();
+                return;
+            }
+            block_->DecrementStrongCounter();
+            if (block_->GetStrongCounter() <= 0) {
+                block_->DeletePointer();
+            }
+        } else {
+            block_->DecrementStrongCounter();
+            if (block_->GetStrongCounter() == 0) {
+                block_->DeletePointer();
+                block_->DestroyBlock();
+            }
         }
     }
 
@@ -83,34 +241,47 @@ public:
     SharedPtr(std::nullptr_t) : ptr_(nullptr), block_(nullptr){};
 
     // constructor from ptr
-    explicit SharedPtr(T* ptr) : ptr_(ptr), block_(new ControlBlockPointer<T>(ptr)) {
-        if constexpr (std::is_convertible_v<T*, IEnableSharedFromThis*>) {
-            ptr->weak_this = *this;
-        }
+    explicit SharedPtr(T* ptr) : ptr_(ptr), block_(new ControlBlockPointer<T, ControlBlock>(ptr)) {
+        EnableSharedFromThisHook(ptr);
     }
 
     template <typename U>
-    SharedPtr(U* ptr) : ptr_(ptr), block_(new ControlBlockPointer<U>(ptr)) {
-        if constexpr (std::is_convertible_v<U*, IEnableSharedFromThis*>) {
-            ptr->weak_this = *this;
-        }
+    SharedPtr(U* ptr) : ptr_(ptr), block_(new ControlBlockPointer<U, ControlBlock>(ptr)) {
+        EnableSharedFromThisHook(ptr);
+    }
+
+    // Sole owner mode: no control block is allocated until the pointer is first copied,
+    // observed by `WeakPtr` or converted. The object is still deleted as `U`. Objects with
+    // `EnableSharedFromThis` (or behind a virtual base of `T`) get a block right away.
+    SharedPtr(T* ptr, LazyControlBlockTag) : ptr_(ptr), block_(nullptr) {
+        AdoptLazily(ptr);
+    }
+
+    template <typename U>
+    SharedPtr(U* ptr, LazyControlBlockTag) : ptr_(ptr), block_(nullptr) {
+        AdoptLazily(ptr);
     }
 
-    SharedPtr(const SharedPtr& other) : ptr_(other.ptr_), block_(other.block_) {
+    SharedPtr(const SharedPtr& other) : ptr_(other.ptr_), block_(other.MaterializeBlock()) {
         IncrementBlockStrongCounter();
     }
 
     template <typename U>
-    SharedPtr(const SharedPtr<U>& other) : ptr_(other.ptr_), block_(other.block_) {
+    SharedPtr(const SharedPtr<U, Policy>& other)
+        : ptr_(other.ptr_), block_(other.MaterializeBlock()) {
         IncrementBlockStrongCounter();
     }
 
     // ctor for control block holder
     template <typename U>
-    SharedPtr(ControlBlockHolder<U>* block) : ptr_(block->GetPointer()), block_(block) {
-        if constexpr (std::is_convertible_v<T*, IEnableSharedFromThis*>) {
-            ptr_->weak_this = *this;
-        }
+    SharedPtr(ControlBlockHolder<U, ControlBlock>* block)
+        : ptr_(block->GetPointer()), block_(block) {
+        EnableSharedFromThisHook(ptr_);
+    }
+
+    // Adopts a control block which already counts this pointer as its (only) strong reference
+    SharedPtr(ControlBlock* block, T* ptr) : ptr_(ptr), block_(block) {
+        EnableSharedFromThisHook(ptr_);
     }
 
     SharedPtr(SharedPtr&& other) : ptr_(other.ptr_), block_(other.block_) {
@@ -119,21 +290,75 @@ public:
     }
 
     template <typename U>
-    SharedPtr(SharedPtr<U>&& other) : ptr_(other.ptr_), block_(other.block_) {
+    SharedPtr(SharedPtr<U, Policy>&& other) : ptr_(other.ptr_), block_(other.MaterializeBlock()) {
         other.block_ = nullptr;
         other.ptr_ = nullptr;
     }
 
+    // Keeps the deleter: it moves into the new control block
+    template <typename U, typename Deleter>
+    SharedPtr(UniquePtr<U, Deleter>&& other) : ptr_(other.Get()), block_(nullptr) {
+        if (ptr_ == nullptr) {
+            return;
+        }
+        block_ = new ControlBlockPointerDeleter<U, Deleter, ControlBlock>(
+            other.Get(), std::move(other.GetDeleter()));
+        U* ptr = other.Release();
+        EnableSharedFromThisHook(ptr);
+    }
+
+    // The object already sits in a control block (`MakeUniquePromotable`, `TryUnwrap`):
+    // adopting it allocates nothing
+    template <typename U>
+    SharedPtr(UniquePtr<U, ControlBlockDeleter<Policy>>&& other)
+        : ptr_(other.Get()), block_(other.GetDeleter().GetBlock()) {
+        if (ptr_ == nullptr) {
+            return;
+        }
+        U* ptr = other.Release();
+        other.GetDeleter().ReleaseBlock();
+        if (block_ == nullptr) {
+            block_ = new ControlBlockPointer<U, ControlBlock>(ptr);
+        }
+        EnableSharedFromThisHook(ptr);
+    }
+
+    // Adopts the object of a `std::shared_ptr` without copying it: the new control block holds
+    // the `std::shared_ptr`. A pointer exported with `ToStdShared` gets its original block back.
+    template <typename U>
+    SharedPtr(std::shared_ptr<U> other) : ptr_(other.get()), block_(nullptr) {
+        if (ptr_ == nullptr) {
+            return;
+        }
+        if (auto* keep_alive = std::get_deleter<StdSharedKeepAlive<U, Policy>>(other)) {
+            block_ = keep_alive->GetOwner().MaterializeBlock();
+            IncrementBlockStrongCounter();
+            return;
+        }
+        U* ptr = other.get();
+        block_ = new ControlBlockStdShared<ControlBlock>(std::move(other));
+        EnableSharedFromThisHook(ptr);
+    }
+
     // Aliasing constructor
     // #8 from https://en.cppreference.com/w/cpp/memory/shared_ptr/shared_ptr
     template <typename U>
-    SharedPtr(const SharedPtr<U>& other, T* ptr) : ptr_(ptr), block_(other.block_) {
+    SharedPtr(const SharedPtr<U, Policy>& other, T* ptr)
+        : ptr_(ptr), block_(other.MaterializeBlock()) {
         IncrementBlockStrongCounter();
     }
 
+    // Aliasing constructor which takes the reference over from `other` instead of adding one
+    template <typename U>
+    SharedPtr(SharedPtr<U, Policy>&& other, T* ptr) : ptr_(ptr), block_(other.MaterializeBlock()) {
+        other.block_ = nullptr;
+        other.ptr_ = nullptr;
+    }
+
     //     Promote `WeakPtr`
     //     #11 from https://en.cppreference.com/w/cpp/memory/shared_ptr/shared_ptr
     explicit SharedPtr(const WeakPtr<T>& other) {
+        static_assert(Policy::kWeakReferences, "NoWeak pointers cannot be made from WeakPtr");
         if (other.block_->GetStrongCounter() == 0) {
             throw BadWeakPtr();
         }
@@ -150,7 +375,7 @@ public:
             return *this;
         }
         DecrementBlockStrongCounter();
-        block_ = other.block_;
+        block_ = other.MaterializeBlock();
         IncrementBlockStrongCounter();
         ptr_ = other.ptr_;
         return *this;
@@ -184,17 +409,58 @@ public:
         block_ = nullptr;
     }
 
+    // Reuses the current block when this is its only reference.
+    // A pointer adopted with `kLazyControlBlock` stays lazy.
     void Reset(T* ptr) {
+        if (IsLazy()) {
+            GetSentinel()->DeleteObject(ptr_);
+            ptr_ = ptr;
+            block_ = nullptr;
+            AdoptLazily(ptr);
+            return;
+        }
+        if (TryReusePointerBlock(ptr)) {
+            return;
+        }
         DecrementBlockStrongCounter();
         ptr_ = ptr;
-        block_ = new ControlBlockPointer<T>(ptr);
+        block_ = new ControlBlockPointer<T, ControlBlock>(ptr);
     }
 
     template <typename U>
     void Reset(U* ptr) {
+        if (TryReusePointerBlock(ptr)) {
+            return;
+        }
         DecrementBlockStrongCounter();
         ptr_ = ptr;
-        block_ = new ControlBlockPointer<U>(ptr);
+        block_ = new ControlBlockPointer<U, ControlBlock>(ptr);
+    }
+
+    // Replaces the value with `T(args...)`. If this is the only reference to a `MakeShared` block,
+    // the new value is constructed in place of the old one, otherwise a new block is allocated.
+    // Should the constructor throw in place, the pointer is left empty.
+    template <typename... Args>
+    void Emplace(Args&&... args) {
+        using Value = std::remove_const_t<T>;
+        using Holder = ControlBlockHolder<Value, ControlBlock>;
+        if (IsUniqueOwner()) {
+            auto* holder = dynamic_cast<Holder*>(block_);
+            if (holder != nullptr && holder->GetPointer() == ptr_) {
+                holder->DeletePointer();
+                try {
+                    new (holder->GetPointer()) Value(std::forward<Args>(args)...);
+                } catch (...) {
+                    block_->DestroyBlock();
+                    block_ = nullptr;
+                    ptr_ = nullptr;
+                    throw;
+                }
+                EnableSharedFromThisHook(ptr_);
+                return;
+            }
+        }
+        *this = SharedPtr(new Holder(std::forward<Args>(args)...));
     }
 
     void Swap(SharedPtr& other) {
@@ -202,6 +468,28 @@ public:
         std::swap(block_, other.block_);
     }
 
+    // Takes the object over if this is its only owner (no other strong or weak references).
+    // The result still uses the same allocation, if there is one. Otherwise returns an empty
+    // pointer and leaves `*this` untouched.
+    // `Release()` on the result gives up only the object: the raw pointer may point into the
+    // control block, which stays in the deleter. Never `delete` it; move the deleter out before
+    // releasing and hand both to a new `UniquePtr` or call the deleter on the pointer.
+    UniquePtr<T, ControlBlockDeleter<Policy>> TryUnwrap() {
+        if (!IsUniqueOwner()) {
+            return UniquePtr<T, ControlBlockDeleter<Policy>>();
+        }
+        // A lazily adopted object can go without a block only if `delete` through `T*` is right
+        ControlBlock* block = block_;
+        if (IsLazy()) {
+            block = GetSentinel()->IsExactType() ? nullptr : GetSentinel()->CreateBlock(ptr_);
+        }
+        UniquePtr<T, ControlBlockDeleter<Policy>> result(ptr_,
+                                                          ControlBlockDeleter<Policy>(block));
+        ptr_ = nullptr;
+        block_ = nullptr;
+        return result;
+    }
+
     ////////////////////////////////////////////////////////////////////////////////////////////////
     // Observers
 
@@ -218,11 +506,37 @@ public:
         if (block_ == nullptr) {
             return 0;
         }
+        if (IsLazy()) {
+            return 1;
+        }
         return block_->GetStrongCounter();
     }
+    // No other `SharedPtr`, `WeakPtr` or (for an adopted one) `std::shared_ptr` owns the object.
+    // `UseCount` only counts `SharedPtr`s; `std::weak_ptr`s of an adopted one are not visible.
+    bool IsUnique() const {
+        return IsUniqueOwner();
+    }
     explicit operator bool() const {
         return ptr_ != nullptr;
     }
+
+    // Identifies the control block, i.e. the owned object rather than the pointer stored here
+    const void* GetOwner() const {
+        return MaterializeBlock();
+    }
+
+    // Owner-based ordering and equality: aliases of one object are equivalent
+    template <typename Other>
+    bool OwnerBefore(const Other& other) const {
+        return std::less<const void*>()(GetOwner(), other.GetOwner());
+    }
+    template <typename Other>
+    bool OwnerEqual(const Other& other) const {
+        return GetOwner() == other.GetOwner();
+    }
+    size_t OwnerHash() const {
+        return std::hash<const void*>()(GetOwner());
+    }
 };
 
 // Allocate memory only once
@@ -230,3 +544,330 @@ template <typename T, typename... Args>
 SharedPtr<T> MakeShared(Args&&... args) {
     return SharedPtr<T>(new ControlBlockHolder<T>(std::forward<Args>(args)...));
 }
+
+// Allocates the object inside a control block right away, so that handing the `UniquePtr` over
+// to `SharedPtr` later needs no allocation
+template <typename T, typename... Args>
+UniquePtr<T, ControlBlockDeleter<>> MakeUniquePromotable(Args&&... args) {
+    auto* block = new ControlBlockHolder<T>(std::forward<Args>(args)...);
+    return UniquePtr<T, ControlBlockDeleter<>>(block->GetPointer(), ControlBlockDeleter<>(block));
+}
+
+// `MakeShared` without the weak counter: a smaller block and no weak checks on release
+template <typename T, typename... Args>
+SharedPtr<T, NoWeak> MakeSharedNoWeak(Args&&... args) {
+    return SharedPtr<T, NoWeak>(
+        new ControlBlockHolder<T, StrongControlBlockBase>(std::forward<Args>(args)...));
+}
+
+// `size` objects constructed from the same `args`, sharing one allocation and one control block.
+// The allocation is freed once every returned pointer (and every copy of them) is gone.
+template <typename T, typename... Args>
+std::vector<SharedPtr<T>> MakeSharedBatch(size_t size, const Args&... args) {
+    std::vector<SharedPtr<T>> batch;
+    if (size == 0) {
+        return batch;
+    }
+    batch.reserve(size);
+    auto* block = ControlBlockArrayHolder<T>::Create(size, args...);
+    T* objects = block->GetPointer();
+    batch.emplace_back(block, objects);
+    for (size_t i = 1; i < size; ++i) {
+        batch.emplace_back(batch.front(), objects + i);
+        if constexpr (std::is_convertible_v<T*, IEnableSharedFromThis*>) {
+            objects[i].weak_this = batch.back();
+        }
+    }
+    return batch;
+}
+
+// `I`-th object of `MakeSharedTuple`, constructed in place from a tuple of arguments
+template <size_t I, typename T>
+struct SharedTuplePiece {
+    template <typename Tuple>
+    explicit SharedTuplePiece(Tuple&& args)
+        : SharedTuplePiece(std::forward<Tuple>(args),
+                           std::make_index_sequence<std::tuple_size_v<std::decay_t<Tuple>>>()) {
+    }
+
+    template <typename Tuple, size_t... Indices>
+    SharedTuplePiece(Tuple&& args, std::index_sequence<Indices...>)
+        : value(std::get<Indices>(std::forward<Tuple>(args))...) {
+    }
+
+    T value;
+};
+
+template <typename Indices, typename... Ts>
+struct SharedTupleStorage;
+
+template <size_t... I, typename... Ts>
+struct SharedTupleStorage<std::index_sequence<I...>, Ts...> : SharedTuplePiece<I, Ts>... {
+    template <typename... Tuples>
+    explicit SharedTupleStorage(Tuples&&... args)
+        : SharedTuplePiece<I, Ts>(std::forward<Tuples>(args))... {
+    }
+
+    template <typename U>
+    std::tuple<SharedPtr<Ts>...> Alias(const SharedPtr<U>& owner) {
+        return std::tuple<SharedPtr<Ts>...>(
+            SharedPtr<Ts>(owner, &static_cast<SharedTuplePiece<I, Ts>&>(*this).value)...);
+    }
+};
+
+// Several objects of different types in one allocation behind one control block. Each object
+// gets a tuple of constructor arguments (`std::forward_as_tuple(...)`), or none at all to
+// default-construct everything. Objects are constructed in order and destroyed in reverse.
+//     auto [a, b] = MakeSharedTuple<A, B>(std::forward_as_tuple(1, 2), std::make_tuple("b"));
+template <typename... Ts, typename... Tuples>
+std::tuple<SharedPtr<Ts>...> MakeSharedTuple(Tuples&&... args) {
+    static_assert(sizeof...(Tuples) == 0 || sizeof...(Tuples) == sizeof...(Ts),
+                  "Pass one argument tuple per object");
+    if constexpr (sizeof...(Tuples) == 0 && sizeof...(Ts) != 0) {
+        return MakeSharedTuple<Ts...>((static_cast<void>(sizeof(Ts)), std::tuple<>())...);
+    } else {
+        using Storage = SharedTupleStorage<std::index_sequence_for<Ts...>, Ts...>;
+        SharedPtr<Storage> owner = MakeShared<Storage>(std::forward<Tuples>(args)...);
+        return owner->Alias(owner);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Interop with std::shared_ptr
+
+// Deleter of a `std::shared_ptr` exported by `ToStdShared`: holds a reference to the object
+// until the last `std::shared_ptr` is gone
+template <typename T, typename Policy>
+class StdSharedKeepAlive {
+public:
+    explicit StdSharedKeepAlive(SharedPtr<T, Policy> owner) : owner_(std::move(owner)) {
+    }
+
+    void operator()(T*) {
+        owner_.Reset();
+    }
+
+    const SharedPtr<T, Policy>& GetOwner() const {
+        return owner_;
+    }
+
+private:
+    SharedPtr<T, Policy> owner_;
+};
+
+// `std::shared_ptr` to the same object, keeping `ptr`'s control block alive. A pointer which was
+// adopted from `std::shared_ptr` in the first place is handed back without an allocation.
+template <typename T, typename Policy>
+std::shared_ptr<T> ToStdShared(SharedPtr<T, Policy> ptr) {
+    if (!ptr) {
+        return std::shared_ptr<T>();
+    }
+    if (auto* block = dynamic_cast<ControlBlockStdShared<typename Policy::ControlBlock>*>(
+            ptr.block_)) {
+        return std::shared_ptr<T>(block->GetOwner(), ptr.Get());
+    }
+    T* raw = ptr.Get();
+    return std::shared_ptr<T>(raw, StdSharedKeepAlive<T, Policy>(std::move(ptr)));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Casts
+// https://en.cppreference.com/w/cpp/memory/shared_ptr/pointer_cast
+// The rvalue overloads move the reference into the result instead of copying it. A failed
+// `DynamicPointerCast` returns an empty pointer and leaves the argument as it was.
+
+template <typename T, typename U, typename Policy>
+SharedPtr<T, Policy> StaticPointerCast(const SharedPtr<U, Policy>& ptr) {
+    return SharedPtr<T, Policy>(ptr, static_cast<T*>(ptr.Get()));
+}
+
+template <typename T, typename U, typename Policy>
+SharedPtr<T, Policy> StaticPointerCast(SharedPtr<U, Policy>&& ptr) {
+    T* result = static_cast<T*>(ptr.Get());
+    return SharedPtr<T, Policy>(std::move(ptr), result);
+}
+
+template <typename T, typename U, typename Policy>
+SharedPtr<T, Policy> DynamicPointerCast(const SharedPtr<U, Policy>& ptr) {
+    T* result = dynamic_cast<T*>(ptr.Get());
+    if (result == nullptr) {
+        return SharedPtr<T, Policy>();
+    }
+    return SharedPtr<T, Policy>(ptr, result);
+}
+
+template <typename T, typename U, typename Policy>
+SharedPtr<T, Policy> DynamicPointerCast(SharedPtr<U, Policy>&& ptr) {
+    T* result = dynamic_cast<T*>(ptr.Get());
+    if (result == nullptr) {
+        return SharedPtr<T, Policy>();
+    }
+    return SharedPtr<T, Policy>(std::move(ptr), result);
+}
+
+template <typename T, typename U, typename Policy>
+SharedPtr<T, Policy> ConstPointerCast(const SharedPtr<U, Policy>& ptr) {
+    return SharedPtr<T, Policy>(ptr, const_cast<T*>(ptr.Get()));
+}
+
+template <typename T, typename U, typename Policy>
+SharedPtr<T, Policy> ConstPointerCast(SharedPtr<U, Policy>&& ptr) {
+    T* result = const_cast<T*>(ptr.Get());
+    return SharedPtr<T, Policy>(std::move(ptr), result);
+}
+
+template <typename T, typename U, typename Policy>
+SharedPtr<T, Policy> ReinterpretPointerCast(const SharedPtr<U, Policy>& ptr) {
+    return SharedPtr<T, Policy>(ptr, reinterpret_cast<T*>(ptr.Get()));
+}
+
+template <typename T, typename U, typename Policy>
+SharedPtr<T, Policy> ReinterpretPointerCast(SharedPtr<U, Policy>&& ptr) {
+    T* result = reinterpret_cast<T*>(ptr.Get());
+    return SharedPtr<T, Policy>(std::move(ptr), result);
+}
+
+// `WeakPtr` casts never touch the strong counter. The object may already be gone, so only
+// `DynamicPointerCast` looks at it, and it locks the pointer first.
+
+template <typename T, typename U>
+WeakPtr<T> StaticPointerCast(const WeakPtr<U>& ptr) {
+    return WeakPtr<T>(ptr, static_cast<T*>(ptr.ptr_));
+}
+
+template <typename T, typename U>
+WeakPtr<T> StaticPointerCast(WeakPtr<U>&& ptr) {
+    T* result = static_cast<T*>(ptr.ptr_);
+    return WeakPtr<T>(std::move(ptr), result);
+}
+
+template <typename T, typename U>
+WeakPtr<T> DynamicPointerCast(const WeakPtr<U>& ptr) {
+    SharedPtr<U> locked = ptr.Lock();
+    T* result = dynamic_cast<T*>(locked.Get());
+    if (result == nullptr) {
+        return WeakPtr<T>();
+    }
+    return WeakPtr<T>(ptr, result);
+}
+
+template <typename T, typename U>
+WeakPtr<T> DynamicPointerCast(WeakPtr<U>&& ptr) {
+    SharedPtr<U> locked = ptr.Lock();
+    T* result = dynamic_cast<T*>(locked.Get());
+    if (result == nullptr) {
+        return WeakPtr<T>();
+    }
+    return WeakPtr<T>(std::move(ptr), result);
+}
+
+template <typename T, typename U>
+WeakPtr<T> ConstPointerCast(const WeakPtr<U>& ptr) {
+    return WeakPtr<T>(ptr, const_cast<T*>(ptr.ptr_));
+}
+
+template <typename T, typename U>
+WeakPtr<T> ConstPointerCast(WeakPtr<U>&& ptr) {
+    T* result = const_cast<T*>(ptr.ptr_);
+    return WeakPtr<T>(std::move(ptr), result);
+}
+
+template <typename T, typename U>
+WeakPtr<T> ReinterpretPointerCast(const WeakPtr<U>& ptr) {
+    return WeakPtr<T>(ptr, reinterpret_cast<T*>(ptr.ptr_));
+}
+
+template <typename T, typename U>
+WeakPtr<T> ReinterpretPointerCast(WeakPtr<U>&& ptr) {
+    T* result = reinterpret_cast<T*>(ptr.ptr_);
+    return WeakPtr<T>(std::move(ptr), result);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Hashing and ordering
+
+// Owner-based functors for `SharedPtr` and `WeakPtr` keys, e.g.
+//     std::unordered_map<WeakPtr<Node>, Info, OwnerHash, OwnerEqual>
+// A weak key keeps its hash after the object expires.
+struct OwnerLess {
+    using is_transparent = void;
+
+    template <typename Left, typename Right>
+    bool operator()(const Left& left, const Right& right) const {
+        return left.OwnerBefore(right);
+    }
+};
+
+struct OwnerHash {
+    using is_transparent = void;
+
+    template <typename Ptr>
+    size_t operator()(const Ptr& ptr) const {
+        return ptr.OwnerHash();
+    }
+};
+
+struct OwnerEqual {
+    using is_transparent = void;
+
+    template <typename Left, typename Right>
+    bool operator()(const Left& left, const Right& right) const {
+        return left.OwnerEqual(right);
+    }
+};
+
+// Stored-pointer functors that also accept raw pointers, so a table keyed by `SharedPtr` or
+// `WeakPtr` can be searched without building a temporary pointer:
+//     std::unordered_set<SharedPtr<Node>, PointerHash, PointerEqual> nodes;
+//     nodes.find(raw_node);
+struct PointerHash {
+    using is_transparent = void;
+
+    template <typename T>
+    size_t operator()(const T* ptr) const {
+        return std::hash<const void*>()(ptr);
+    }
+    template <typename T, typename Policy>
+    size_t operator()(const SharedPtr<T, Policy>& ptr) const {
+        return (*this)(ptr.Get());
+    }
+    template <typename T>
+    size_t operator()(const WeakPtr<T>& ptr) const {
+        return (*this)(ptr.ptr_);
+    }
+};
+
+struct PointerEqual {
+    using is_transparent = void;
+
+    template <typename Left, typename Right>
+    bool operator()(const Left& left, const Right& right) const {
+        return Address(left) == Address(right);
+    }
+
+private:
+    template <typename T>
+    static const void* Address(const T* ptr) {
+        return ptr;
+    }
+    template <typename T, typename Policy>
+    static const void* Address(const SharedPtr<T, Policy>& ptr) {
+        return ptr.Get();
+    }
+    template <typename T>
+    static const void* Address(const WeakPtr<T>& ptr) {
+        return ptr.ptr_;
+    }
+};
+
+// Hashes the stored pointer, consistently with `operator==`
+namespace std {
+
+template <typename T, typename Policy>
+struct hash<SharedPtr<T, Policy>> {
+    size_t operator()(const SharedPtr<T, Policy>& ptr) const {
+        return std::hash<T*>()(ptr.Get());
+    }
+};
+
+}  // namespace std
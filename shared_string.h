@@ -0,0 +1,341 @@
+#pragma once
+
+#include <algorithm>
+#include <compare>
+#include <cstddef>  // size_t
+#include <cstring>
+#include <functional>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include "shared.h"
+
+// Control block followed by the characters, in one allocation
+class SharedStringBlock : public ControlBlockBase {
+public:
+    // The characters are left uninitialized for the caller to fill
+    static SharedStringBlock* Create(size_t size) {
+        void* memory = ::operator new(sizeof(SharedStringBlock) + size);
+        return new (memory) SharedStringBlock();
+    }
+
+    char* GetPointer() {
+        return reinterpret_cast<char*>(this + 1);
+    }
+
+    void DeletePointer() override {
+    }
+
+    void DestroyBlock() override {
+        this->~SharedStringBlock();
+        ::operator delete(this);
+    }
+
+private:
+    SharedStringBlock() {
+        strong_counter = 1;
+    }
+};
+
+// Immutable, reference counted byte string (UTF-8 by convention; it is not validated). Copies and
+// substrings share the buffer: `Substr` is a counter increment, never a copy. There is no
+// terminating '\0', since a substring cannot have one.
+class SharedString {
+public:
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Constructors
+
+    SharedString() = default;
+
+    // The only copy of the characters: into a fresh block
+    explicit SharedString(std::string_view text) : size_(text.size()) {
+        if (text.empty()) {
+            return;
+        }
+        SharedStringBlock* block = SharedStringBlock::Create(text.size());
+        std::memcpy(block->GetPointer(), text.data(), text.size());
+        data_ = SharedPtr<const char>(block, block->GetPointer());
+    }
+
+    SharedString(SharedPtr<const char> data, size_t size) : data_(std::move(data)), size_(size) {
+    }
+
+    SharedString(const SharedString&) = default;
+    SharedString& operator=(const SharedString&) = default;
+
+    // The source is left empty rather than with its size over a null buffer
+    SharedString(SharedString&& other)
+        : data_(std::move(other.data_)), size_(std::exchange(other.size_, 0)) {
+    }
+
+    SharedString& operator=(SharedString&& other) {
+        if (this != &other) {
+            data_ = std::move(other.data_);
+            size_ = std::exchange(other.size_, 0);
+        }
+        return *this;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Substrings
+
+    // Throws std::out_of_range if `pos > Size()`; `count` is clamped like in `std::string`
+    SharedString Substr(size_t pos, size_t count = std::string_view::npos) const {
+        if (pos > size_) {
+            throw std::out_of_range("SharedString::Substr");
+        }
+        count = std::min(count, size_ - pos);
+        if (count == 0) {
+            return SharedString();
+        }
+        return SharedString(SharedPtr<const char>(data_, data_.Get() + pos), count);
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Observers
+
+    const char* Data() const {
+        return data_.Get();
+    }
+    size_t Size() const {
+        return size_;
+    }
+    bool Empty() const {
+        return size_ == 0;
+    }
+    char operator[](size_t index) const {
+        return data_.Get()[index];
+    }
+    std::string_view View() const {
+        return std::string_view(Data(), size_);
+    }
+    operator std::string_view() const {
+        return View();
+    }
+    std::string ToString() const {
+        return std::string(View());
+    }
+    // Whether both share one buffer (substrings of the same string do)
+    bool SharesWith(const SharedString& other) const {
+        return data_.OwnerEqual(other.data_);
+    }
+
+    bool operator==(const SharedString& other) const {
+        return View() == other.View();
+    }
+    auto operator<=>(const SharedString& other) const {
+        return View() <=> other.View();
+    }
+
+private:
+    SharedPtr<const char> data_;
+    size_t size_ = 0;
+};
+
+template <>
+struct std::hash<SharedString> {
+    size_t operator()(const SharedString& string) const {
+        return std::hash<std::string_view>()(string.View());
+    }
+};
+
+// Concatenation of `SharedString`s as a binary tree: `+` copies no characters. The tree is kept
+// height-balanced like an AVL tree, so `+` allocates O(log n) nodes along one edge of the taller
+// operand and indexing is O(log n) however the rope was built. Short results are flattened
+// instead, so appending small pieces does not grow trees of tiny leaves.
+class SharedRope {
+    struct Node;
+    using NodePtr = SharedPtr<const Node, NoWeak>;
+
+    struct Node {
+        SharedString leaf;
+        NodePtr left;
+        NodePtr right;
+        size_t size = 0;
+        size_t depth = 0;  // leaves are at depth 0
+    };
+
+public:
+    // Pieces up to this size are copied into one leaf rather than linked
+    static constexpr size_t kFlattenThreshold = 64;
+
+    // A balanced tree this deep would need more than 2^64 leaves (Fibonacci(94) > 2^64)
+    static constexpr size_t kMaxDepth = 92;
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Constructors
+
+    SharedRope() = default;
+
+    SharedRope(SharedString string) {
+        if (!string.Empty()) {
+            root_ = MakeSharedNoWeak<const Node>(Node{std::move(string), nullptr, nullptr, 0, 0});
+        }
+    }
+
+    friend SharedRope operator+(const SharedRope& left, const SharedRope& right) {
+        if (left.Empty()) {
+            return right;
+        }
+        if (right.Empty()) {
+            return left;
+        }
+        if (left.Size() + right.Size() <= kFlattenThreshold) {
+            return SharedRope(SharedRope(Join(left.root_, right.root_)).Flatten());
+        }
+        return SharedRope(Join(left.root_, right.root_));
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Observers
+
+    size_t Size() const {
+        return root_ ? Size(root_) : 0;
+    }
+    bool Empty() const {
+        return Size() == 0;
+    }
+    // Levels of concatenation nodes above the deepest piece
+    size_t Depth() const {
+        return root_ ? root_->depth : 0;
+    }
+
+    // O(log n)
+    char operator[](size_t index) const {
+        const Node* node = root_.Get();
+        while (node->left) {
+            size_t left_size = Size(node->left);
+            if (index < left_size) {
+                node = node->left.Get();
+            } else {
+                index -= left_size;
+                node = node->right.Get();
+            }
+        }
+        return node->leaf[index];
+    }
+
+    // Calls `function(std::string_view)` for every piece, in order
+    template <typename Function>
+    void ForEachChunk(Function&& function) const {
+        if (!root_) {
+            return;
+        }
+        const Node* pending[kMaxDepth];  // right subtrees still to visit
+        size_t count = 0;
+        const Node* node = root_.Get();
+        while (true) {
+            while (node->left) {
+                pending[count++] = node->right.Get();
+                node = node->left.Get();
+            }
+            function(node->leaf.View());
+            if (count == 0) {
+                return;
+            }
+            node = pending[--count];
+        }
+    }
+
+    // One buffer with the whole text: a single allocation and copy. A rope of one piece
+    // returns that piece as is.
+    SharedString Flatten() const {
+        if (!root_) {
+            return SharedString();
+        }
+        if (!root_->left) {
+            return root_->leaf;
+        }
+        size_t size = Size();
+        SharedStringBlock* block = SharedStringBlock::Create(size);
+        char* out = block->GetPointer();
+        ForEachChunk([&out](std::string_view chunk) {
+            std::memcpy(out, chunk.data(), chunk.size());
+            out += chunk.size();
+        });
+        return SharedString(SharedPtr<const char>(block, block->GetPointer()), size);
+    }
+
+    std::string ToString() const {
+        std::string result;
+        result.reserve(Size());
+        ForEachChunk([&result](std::string_view chunk) { result.append(chunk); });
+        return result;
+    }
+
+private:
+    explicit SharedRope(NodePtr root) : root_(std::move(root)) {
+    }
+
+    static size_t Size(const NodePtr& node) {
+        return node->left ? node->size : node->leaf.Size();
+    }
+
+    static NodePtr MakeNode(NodePtr left, NodePtr right) {
+        size_t size = Size(left) + Size(right);
+        size_t depth = std::max(left->depth, right->depth) + 1;
+        return MakeSharedNoWeak<const Node>(
+            Node{SharedString(), std::move(left), std::move(right), size, depth});
+    }
+
+    // (a, (b, c)) -> ((a, b), c)
+    static NodePtr RotateLeft(const NodePtr& node) {
+        return MakeNode(MakeNode(node->left, node->right->left), node->right->right);
+    }
+
+    // ((a, b), c) -> (a, (b, c))
+    static NodePtr RotateRight(const NodePtr& node) {
+        return MakeNode(node->left->left, MakeNode(node->left->right, node->right));
+    }
+
+    // Concatenation of two balanced trees which stays balanced, after Blelloch, Ferizovic and
+    // Sun, "Just Join for Parallel Ordered Sets". Recursion depth is bounded by `kMaxDepth`.
+    static NodePtr Join(const NodePtr& left, const NodePtr& right) {
+        if (left->depth > right->depth + 1) {
+            return JoinRight(left, right);
+        }
+        if (right->depth > left->depth + 1) {
+            return JoinLeft(left, right);
+        }
+        return MakeNode(left, right);
+    }
+
+    // `left` is more than one level deeper: `right` goes down its right edge
+    static NodePtr JoinRight(const NodePtr& left, const NodePtr& right) {
+        const NodePtr& outer = left->left;
+        const NodePtr& inner = left->right;
+        if (inner->depth <= right->depth + 1) {
+            NodePtr joined = MakeNode(inner, right);
+            if (joined->depth <= outer->depth + 1) {
+                return MakeNode(outer, std::move(joined));
+            }
+            return RotateLeft(MakeNode(outer, RotateRight(joined)));
+        }
+        NodePtr joined = JoinRight(inner, right);
+        bool balanced = joined->depth <= outer->depth + 1;
+        NodePtr node = MakeNode(outer, std::move(joined));
+        return balanced ? node : RotateLeft(node);
+    }
+
+    // Mirror image of `JoinRight`
+    static NodePtr JoinLeft(const NodePtr& left, const NodePtr& right) {
+        const NodePtr& outer = right->right;
+        const NodePtr& inner = right->left;
+        if (inner->depth <= left->depth + 1) {
+            NodePtr joined = MakeNode(left, inner);
+            if (joined->depth <= outer->depth + 1) {
+                return MakeNode(std::move(joined), outer);
+            }
+            return RotateRight(MakeNode(RotateLeft(joined), outer));
+        }
+        NodePtr joined = JoinLeft(left, inner);
+        bool balanced = joined->depth <= outer->depth + 1;
+        NodePtr node = MakeNode(std::move(joined), outer);
+        return balanced ? node : RotateRight(node);
+    }
+
+    NodePtr root_;
+};
@@ -0,0 +1,328 @@
+#pragma once
+
+#include <cstddef>  // size_t
+#include <cstdint>
+#include <fstream>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "shared.h"
+#include "weak.h"
+
+class SoftBudget;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Memory pressure signal
+
+// Share of the memory limit currently in use, in [0, 1]. Looks at cgroup v2, then cgroup v1,
+// then /proc/meminfo. Returns a negative value if none of them can be read.
+inline double ReadMemoryUsageRatio() {
+    auto read_number = [](const char* path, double& value) {
+        std::ifstream in(path);
+        std::string token;
+        if (!(in >> token) || token == "max") {
+            return false;
+        }
+        try {
+            value = std::stod(token);
+        } catch (...) {
+            return false;
+        }
+        return true;
+    };
+
+    double current = 0;
+    double limit = 0;
+    if (read_number("/sys/fs/cgroup/memory.current", current) &&
+        read_number("/sys/fs/cgroup/memory.max", limit) && limit > 0) {
+        return current / limit;
+    }
+    // cgroup v1 reports "no limit" as a huge number close to INT64_MAX
+    if (read_number("/sys/fs/cgroup/memory/memory.usage_in_bytes", current) &&
+        read_number("/sys/fs/cgroup/memory/memory.limit_in_bytes", limit) && limit > 0 &&
+        limit < static_cast<double>(std::numeric_limits<int64_t>::max() / 2)) {
+        return current / limit;
+    }
+
+    std::ifstream meminfo("/proc/meminfo");
+    std::string key;
+    double amount = 0;
+    std::string unit;
+    double total = -1;
+    double available = -1;
+    while (meminfo >> key >> amount >> unit) {
+        if (key == "MemTotal:") {
+            total = amount;
+        } else if (key == "MemAvailable:") {
+            available = amount;
+        }
+    }
+    if (total <= 0 || available < 0) {
+        return -1;
+    }
+    return 1.0 - available / total;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Soft reference registration
+
+// One soft reference, as seen by `SoftBudget`. While registered it pins the object with a strong
+// reference; eviction drops that reference and the object is kept alive only by `SharedPtr`s.
+class SoftSlotBase {
+    friend class SoftBudget;
+
+public:
+    static constexpr size_t kNotRegistered = std::numeric_limits<size_t>::max();
+
+    explicit SoftSlotBase(size_t bytes) : bytes_(bytes) {
+    }
+
+    SoftSlotBase(const SoftSlotBase&) = delete;
+    SoftSlotBase& operator=(const SoftSlotBase&) = delete;
+
+    virtual ~SoftSlotBase();
+
+    size_t GetBytes() const {
+        return bytes_;
+    }
+
+    bool IsResident() const {
+        return index_ != kNotRegistered;
+    }
+
+    // Second chance for the clock hand
+    void Touch() {
+        referenced_ = true;
+    }
+
+protected:
+    virtual void Evict() = 0;
+
+private:
+    SoftBudget* budget_ = nullptr;
+    size_t bytes_;
+    size_t index_ = kNotRegistered;
+    bool referenced_ = true;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// SoftBudget
+
+// Owns the strong references of all soft pointers registered in it. Once the total size exceeds
+// the budget (or the memory pressure threshold is crossed) entries are evicted in clock order.
+// The pressure signal is read by `Register` every `SetPressureCheckInterval` registrations, so
+// eviction starts before allocations fail even if nobody calls `RelieveMemoryPressure`.
+class SoftBudget {
+    friend class SoftSlotBase;
+
+public:
+    explicit SoftBudget(size_t budget_bytes = std::numeric_limits<size_t>::max())
+        : budget_(budget_bytes) {
+    }
+
+    SoftBudget(const SoftBudget&) = delete;
+    SoftBudget& operator=(const SoftBudget&) = delete;
+
+    // Evicts every entry: `Shrink(0)` would keep zero-byte ones pointing at this budget
+    ~SoftBudget() {
+        while (!slot_ring_.empty()) {
+            SoftSlotBase* slot = slot_ring_.back();
+            Unregister(slot);
+            slot->Evict();
+        }
+    }
+
+    static SoftBudget& Default() {
+        static SoftBudget budget;
+        return budget;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Modifiers
+
+    void SetBudget(size_t budget_bytes) {
+        budget_ = budget_bytes;
+        Shrink(budget_);
+    }
+
+    void SetPressureThreshold(double usage_ratio) {
+        pressure_threshold_ = usage_ratio;
+    }
+
+    // Reading the signal means reading files, so `Register` only does it on every
+    // `registrations`-th call. Zero turns the automatic check off.
+    void SetPressureCheckInterval(size_t registrations) {
+        pressure_check_interval_ = registrations;
+        registrations_since_check_ = 0;
+    }
+
+    void Register(SoftSlotBase* slot) {
+        slot_ring_.push_back(slot);  // first: if it throws, the slot stays unregistered
+        slot->budget_ = this;
+        slot->index_ = slot_ring_.size() - 1;
+        slot->referenced_ = true;
+        usage_ += slot->bytes_;
+        if (usage_ > budget_) {
+            Shrink(budget_);
+        }
+        if (pressure_check_interval_ != 0 &&
+            ++registrations_since_check_ >= pressure_check_interval_) {
+            registrations_since_check_ = 0;
+            RelieveMemoryPressure();
+        }
+    }
+
+    // Evicts entries until at most `target_bytes` stay resident, returns the evicted byte count
+    size_t Shrink(size_t target_bytes) {
+        size_t evicted = 0;
+        while (usage_ > target_bytes && !slot_ring_.empty()) {
+            if (clock_hand_ >= slot_ring_.size()) {
+                clock_hand_ = 0;
+            }
+            SoftSlotBase* slot = slot_ring_[clock_hand_];
+            if (slot->referenced_) {
+                slot->referenced_ = false;
+                ++clock_hand_;
+                continue;
+            }
+            evicted += slot->bytes_;
+            Unregister(slot);  // the hand now points at the slot swapped into this position
+            slot->Evict();
+        }
+        return evicted;
+    }
+
+    // Reads the pressure signal and, if it is above the threshold, evicts half of the resident
+    // bytes. Called from `Register` as well; call it directly from timers or an OOM alarm handler
+    // to react while no new entries arrive.
+    size_t RelieveMemoryPressure() {
+        if (ReadMemoryUsageRatio() < pressure_threshold_) {
+            return 0;
+        }
+        return Shrink(usage_ / 2);
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Observers
+
+    size_t GetBudget() const {
+        return budget_;
+    }
+
+    size_t GetUsage() const {
+        return usage_;
+    }
+
+    size_t GetResidentCount() const {
+        return slot_ring_.size();
+    }
+
+private:
+    void Unregister(SoftSlotBase* slot) {
+        size_t index = slot->index_;
+        slot_ring_[index] = slot_ring_.back();
+        slot_ring_[index]->index_ = index;
+        slot_ring_.pop_back();
+        usage_ -= slot->bytes_;
+        slot->index_ = SoftSlotBase::kNotRegistered;
+        slot->budget_ = nullptr;
+    }
+
+private:
+    std::vector<SoftSlotBase*> slot_ring_;
+    size_t clock_hand_ = 0;
+    size_t budget_;
+    size_t usage_ = 0;
+    double pressure_threshold_ = 0.9;
+    size_t pressure_check_interval_ = 256;
+    size_t registrations_since_check_ = 0;
+};
+
+inline SoftSlotBase::~SoftSlotBase() {
+    if (IsResident()) {
+        budget_->Unregister(this);
+    }
+}
+
+template <typename T>
+class SoftSlot : public SoftSlotBase {
+public:
+    SoftSlot(const SharedPtr<T>& ptr, size_t bytes)
+        : SoftSlotBase(bytes), strong_(ptr), weak_(ptr) {
+    }
+
+    SharedPtr<T> Lock() {
+        Touch();
+        return weak_.Lock();
+    }
+
+    bool Expired() const {
+        return weak_.Expired();
+    }
+
+protected:
+    void Evict() override {
+        strong_.Reset();
+    }
+
+private:
+    SharedPtr<T> strong_;
+    WeakPtr<T> weak_;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// SoftPtr
+
+// Keeps the object alive like `SharedPtr` until its budget evicts it, then behaves like an
+// expired (or, if other owners remain, a live) `WeakPtr`. Copies share one registration.
+template <typename T>
+class SoftPtr {
+public:
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Constructors
+
+    SoftPtr() = default;
+
+    explicit SoftPtr(const SharedPtr<T>& ptr, size_t bytes = sizeof(T),
+                     SoftBudget& budget = SoftBudget::Default()) {
+        if (!ptr) {
+            return;
+        }
+        slot_ = MakeShared<SoftSlot<T>>(ptr, bytes);
+        budget.Register(slot_.Get());
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Modifiers
+
+    void Reset() {
+        slot_.Reset();
+    }
+
+    void Swap(SoftPtr& other) {
+        slot_.Swap(other.slot_);
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Observers
+
+    SharedPtr<T> Lock() const {
+        if (!slot_) {
+            return SharedPtr<T>();
+        }
+        return slot_->Lock();
+    }
+
+    bool Expired() const {
+        return !slot_ || slot_->Expired();
+    }
+
+    // True while the budget still pins the object
+    bool IsResident() const {
+        return slot_ && slot_->IsResident();
+    }
+
+private:
+    SharedPtr<SoftSlot<T>> slot_;
+};
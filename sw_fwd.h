@@ -1,18 +1,22 @@
 #pragma once
 
+#include <algorithm>
+#include <cstddef>
 #include <exception>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
 
-// trying to make proper control block:
-class ControlBlockBase {
+#include "compressed_pair.h"
+
+// Strong counter only: enough for pointers which are never observed by `WeakPtr`
+class StrongControlBlockBase {
 public:
     int GetStrongCounter() const {
         return strong_counter;
     }
 
-    int GetWeakCounter() const {
-        return weak_counter;
-    }
-
     void IncrementStrongCounter() {
         ++strong_counter;
     }
@@ -21,6 +25,26 @@ public:
         --strong_counter;
     }
 
+    virtual ~StrongControlBlockBase() = default;
+
+    virtual void DeletePointer() = 0;
+
+    // Frees the block itself; blocks living outside the default heap override it
+    virtual void DestroyBlock() {
+        delete this;
+    }
+
+public:
+    int strong_counter = 0;
+};
+
+// trying to make proper control block:
+class ControlBlockBase : public StrongControlBlockBase {
+public:
+    int GetWeakCounter() const {
+        return weak_counter;
+    }
+
     void IncrementWeakCounter() {
         ++weak_counter;
     }
@@ -29,21 +53,28 @@ public:
         --weak_counter;
     }
 
-    virtual ~ControlBlockBase() = default;
-
-    virtual void DeletePointer() = 0;
-
 public:
-    int strong_counter = 0;
     int weak_counter = 0;
 };
 
-template <typename T>
-class ControlBlockPointer : public ControlBlockBase {
+// Ownership policies of `SharedPtr`
+struct WithWeak {
+    using ControlBlock = ControlBlockBase;
+    static constexpr bool kWeakReferences = true;
+};
+
+// No weak counter in the block and no `WeakPtr` / `EnableSharedFromThis` support: releasing is
+// a single decrement-and-destroy
+struct NoWeak {
+    using ControlBlock = StrongControlBlockBase;
+    static constexpr bool kWeakReferences = false;
+};
+
+template <typename T, typename Base = ControlBlockBase>
+class ControlBlockPointer : public Base {
 public:
     ControlBlockPointer(T* ptr) : ptr_(ptr) {
-        strong_counter = 1;
-        weak_counter = 0;
+        this->strong_counter = 1;
     }
 
     ~ControlBlockPointer() override {
@@ -58,16 +89,20 @@ public:
         return ptr_;
     }
 
+    void ResetPointer(T* ptr) {
+        ptr_ = ptr;
+    }
+
 protected:
     T* ptr_;
 };
 
-template <typename T>
-class ControlBlockHolder : public ControlBlockBase {
+template <typename T, typename Base = ControlBlockBase>
+class ControlBlockHolder : public Base {
 public:
     template <typename... Args>
     ControlBlockHolder(Args&&... args) {
-        strong_counter = 1;
+        this->strong_counter = 1;
         new (&storage_) T(std::forward<Args>(args)...);
     }
 
@@ -87,9 +122,167 @@ protected:
     std::aligned_storage_t<sizeof(T), alignof(T)> storage_;
 };
 
+// Control block followed by `size` objects in the same allocation
+template <typename T>
+class ControlBlockArrayHolder : public ControlBlockBase {
+public:
+    // Every object is constructed from the same `args`
+    template <typename... Args>
+    static ControlBlockArrayHolder* Create(size_t size, const Args&... args) {
+        void* memory = ::operator new(ObjectsOffset() + sizeof(T) * size, Alignment());
+        auto* block = new (memory) ControlBlockArrayHolder(size);
+        T* objects = block->GetPointer();
+        size_t constructed = 0;
+        try {
+            for (; constructed < size; ++constructed) {
+                new (objects + constructed) T(args...);
+            }
+        } catch (...) {
+            block->size_ = constructed;
+            block->DeletePointer();
+            block->DestroyBlock();
+            throw;
+        }
+        return block;
+    }
+
+    T* GetPointer() {
+        return reinterpret_cast<T*>(reinterpret_cast<char*>(this) + ObjectsOffset());
+    }
+
+    size_t GetSize() const {
+        return size_;
+    }
+
+    void DeletePointer() override {
+        T* objects = GetPointer();
+        for (size_t i = size_; i > 0; --i) {
+            objects[i - 1].~T();
+        }
+    }
+
+    void DestroyBlock() override {
+        this->~ControlBlockArrayHolder();
+        ::operator delete(this, Alignment());
+    }
+
+private:
+    explicit ControlBlockArrayHolder(size_t size) : size_(size) {
+        strong_counter = 1;
+    }
+
+    static constexpr std::align_val_t Alignment() {
+        return std::align_val_t(std::max(alignof(ControlBlockArrayHolder), alignof(T)));
+    }
+
+    static constexpr size_t ObjectsOffset() {
+        return (sizeof(ControlBlockArrayHolder) + alignof(T) - 1) / alignof(T) * alignof(T);
+    }
+
+    size_t size_;
+};
+
+// Like `ControlBlockPointer`, but releases the pointer with a custom deleter
+template <typename T, typename Deleter, typename Base = ControlBlockBase>
+class ControlBlockPointerDeleter : public Base {
+public:
+    ControlBlockPointerDeleter(T* ptr, Deleter deleter) : data_(ptr, std::move(deleter)) {
+        this->strong_counter = 1;
+    }
+
+    void DeletePointer() override {
+        data_.GetSecond()(data_.GetFirst());
+    }
+
+    T* GetPointer() const {
+        return data_.GetFirst();
+    }
+
+    Deleter& GetDeleter() {
+        return data_.GetSecond();
+    }
+
+protected:
+    CompressedPair<T*, Deleter> data_;
+};
+
+// Keeps an adopted `std::shared_ptr` alive: its own control block owns the object
+template <typename Base = ControlBlockBase>
+class ControlBlockStdShared : public Base {
+public:
+    explicit ControlBlockStdShared(std::shared_ptr<const void> owner) : owner_(std::move(owner)) {
+        this->strong_counter = 1;
+    }
+
+    void DeletePointer() override {
+        owner_.reset();
+    }
+
+    const std::shared_ptr<const void>& GetOwner() const {
+        return owner_;
+    }
+
+private:
+    std::shared_ptr<const void> owner_;
+};
+
+// Stands in for the control block of a `SharedPtr<T>` adopted with `kLazyControlBlock` until the
+// pointer is first shared. It is never counted or freed: the owner deletes the object through it.
+// Its strong counter stays at zero, which no block held by a `SharedPtr` has otherwise, so the
+// owner can tell it apart from a real block without knowing the adopted type.
+template <typename T, typename Base>
+class SoleOwnerSentinel : public Base {
+public:
+    void DeletePointer() override {
+    }
+
+    void DestroyBlock() override {
+    }
+
+    // `ptr` is the owner's pointer; the object is deleted as the type it was adopted with
+    virtual void DeleteObject(T* ptr) const = 0;
+
+    // The real block, counting one strong reference
+    virtual Base* CreateBlock(T* ptr) const = 0;
+
+    // Whether `delete` through `T*` is the same as `DeleteObject`
+    virtual bool IsExactType() const = 0;
+};
+
+// One instance per adopted type `U`, which is `T` or derives from it non-virtually
+template <typename T, typename U, typename Base>
+class SoleOwnerSentinelFor final : public SoleOwnerSentinel<T, Base> {
+public:
+    static SoleOwnerSentinel<T, Base>* Get() {
+        static SoleOwnerSentinelFor sentinel;
+        return &sentinel;
+    }
+
+    void DeleteObject(T* ptr) const override {
+        delete Downcast(ptr);
+    }
+
+    Base* CreateBlock(T* ptr) const override {
+        return new ControlBlockPointer<U, Base>(Downcast(ptr));
+    }
+
+    bool IsExactType() const override {
+        return std::is_same_v<T, U>;
+    }
+
+private:
+    static U* Downcast(T* ptr) {
+        return static_cast<U*>(const_cast<std::remove_const_t<T>*>(ptr));
+    }
+};
+
+struct LazyControlBlockTag {};
+
+inline constexpr LazyControlBlockTag kLazyControlBlock{};
+
 class BadWeakPtr : public std::exception {};
 
-template <typename T>
+template <typename T, typename Policy = WithWeak>
 class SharedPtr;
 
 template <typename T>
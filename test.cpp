@@ -516,4 +516,67 @@ TEST_CASE("Upcasts") {
         UniquePtr<MyInt, Deleter<MyInt>> s2(new MyInt);
         s2 = std::move(s);
     }
-}
\ No newline at end of file
+}
+
+TEST_CASE("MakeUnique") {
+    SECTION("Single object") {
+        auto ptr = MakeUnique<MyInt>(42);
+
+        REQUIRE(*ptr == 42);
+        REQUIRE(MyInt::AliveCount() == 1);
+    }
+
+    SECTION("Array") {
+        auto arr = MakeUnique<int[]>(5);
+
+        for (size_t i = 0; i < 5; ++i) {
+            REQUIRE(arr[i] == 0);
+        }
+    }
+
+    REQUIRE(MyInt::AliveCount() == 0);
+}
+
+TEST_CASE("DynamicUniqueCast") {
+    UniquePtr<Person> person(new Alice);
+    auto bob = DynamicUniqueCast<Bob>(std::move(person));
+    REQUIRE(!bob);
+    REQUIRE(person);
+
+    Person* raw = person.Get();
+    auto alice = DynamicUniqueCast<Alice>(std::move(person));
+    REQUIRE(alice.Get() == raw);
+    REQUIRE(!person);
+    REQUIRE(alice->GetFavoriteNumber() == 37);
+}
+
+TEST_CASE("std::unique_ptr interop") {
+    SECTION("Default deleter") {
+        std::unique_ptr<Person> std_ptr = std::make_unique<Alice>();
+        Person* raw = std_ptr.get();
+        UniquePtr<Person> ptr = std::move(std_ptr);
+        REQUIRE(!std_ptr);
+        REQUIRE(ptr.Get() == raw);
+
+        std::unique_ptr<Person> back = ToStdUnique(std::move(ptr));
+        REQUIRE(!ptr);
+        REQUIRE(back->GetFavoriteNumber() == 37);
+    }
+
+    SECTION("Custom deleter") {
+        std::unique_ptr<MyInt, Deleter<MyInt>> std_ptr(new MyInt(5), Deleter<MyInt>(7));
+        UniquePtr<MyInt, Deleter<MyInt>> ptr = std::move(std_ptr);
+        REQUIRE(*ptr == 5);
+        REQUIRE(ptr.GetDeleter().GetTag() == 7);
+
+        auto back = ToStdUnique(std::move(ptr));
+        REQUIRE(back.get_deleter().GetTag() == 7);
+    }
+
+    SECTION("Arrays") {
+        UniquePtr<int[]> ptr = std::make_unique<int[]>(3);
+        ptr[2] = 4;
+        std::unique_ptr<int[]> back = ToStdUnique(std::move(ptr));
+        REQUIRE(back[2] == 4);
+    }
+}
@@ -0,0 +1,73 @@
+#include "aligned.h"
+
+#include <common/my_int.h>
+
+#include <catch.hpp>
+#include <cstdint>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+bool IsAligned(const void* ptr, size_t alignment) {
+    return reinterpret_cast<uintptr_t>(ptr) % alignment == 0;
+}
+
+}  // namespace
+
+TEST_CASE("AlignedPaddedSize") {
+    REQUIRE(AlignedPaddedSize<float>(0) == 0);
+    REQUIRE(AlignedPaddedSize<float>(1) == 16);
+    REQUIRE(AlignedPaddedSize<float>(16) == 16);
+    REQUIRE(AlignedPaddedSize<double>(17) == 24);
+    REQUIRE(AlignedPaddedSize<char[3]>(1, 64) == 64);
+    REQUIRE(AlignedPaddedSize<int32_t>(5, 32) == 8);
+
+    REQUIRE_THROWS_AS(AlignedPaddedSize<float>(1, 0), std::invalid_argument);
+    REQUIRE_THROWS_AS(AlignedPaddedSize<float>(SIZE_MAX), std::bad_array_new_length);
+    REQUIRE_THROWS_AS(AlignedPaddedSize<float>(SIZE_MAX / 2), std::bad_array_new_length);
+    REQUIRE_THROWS_AS(MakeUniqueAligned<double[]>(SIZE_MAX / 4), std::bad_array_new_length);
+}
+
+TEST_CASE("MakeUniqueAligned") {
+    SECTION("Alignment and padding") {
+        auto data = MakeUniqueAligned<float[]>(100);
+
+        REQUIRE(IsAligned(data.Get(), 64));
+        REQUIRE(data.GetDeleter().GetSize() == 112);
+        for (size_t i = 0; i < 112; ++i) {
+            REQUIRE(data[i] == 0.0f);
+        }
+    }
+
+    SECTION("Custom alignment") {
+        auto data = MakeUniqueAligned<double[]>(3, 4096);
+        REQUIRE(IsAligned(data.Get(), 4096));
+        REQUIRE(data.GetDeleter().GetAlignment() == 4096);
+    }
+
+    SECTION("Non-trivial elements") {
+        {
+            auto data = MakeUniqueAligned<MyInt[]>(3, 16);
+            REQUIRE(MyInt::AliveCount() == static_cast<int>(data.GetDeleter().GetSize()));
+        }
+        REQUIRE(MyInt::AliveCount() == 0);
+    }
+
+    SECTION("Bad alignment") {
+        REQUIRE_THROWS_AS(MakeUniqueAligned<double[]>(3, 48), std::invalid_argument);
+        REQUIRE_THROWS_AS(MakeUniqueAligned<double[]>(3, 4), std::invalid_argument);
+    }
+}
+
+TEST_CASE("MakeSharedAligned") {
+    SharedPtr<int32_t> copy;
+    {
+        SharedPtr<int32_t> data = MakeSharedAligned<int32_t[]>(10);
+        REQUIRE(IsAligned(data.Get(), 64));
+        data.Get()[15] = 42;
+        copy = data;
+    }
+    REQUIRE(copy.UseCount() == 1);
+    REQUIRE(copy.Get()[15] == 42);
+}
@@ -0,0 +1,136 @@
+#include "cow.h"
+
+#include <catch.hpp>
+
+#include "allocations_checker.h"
+
+#include <map>
+#include <memory>
+#include <string>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+struct Config {
+    Config() = default;
+
+    Config(const Config& other) : values(other.values) {
+        ++copies;
+    }
+
+    std::map<std::string, std::string> values;
+    static int copies;
+};
+
+int Config::copies = 0;
+
+size_t CountKeys(CowPtr<Config> config) {
+    return config->values.size();
+}
+
+}  // namespace
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("CowPtr") {
+    SECTION("Copies share until written") {
+        Config::copies = 0;
+        auto config = MakeCow<Config>();
+        config.Mut().values["mode"] = "fast";
+        REQUIRE(CountKeys(config) == 1);
+        REQUIRE(Config::copies == 0);
+
+        CowPtr<Config> snapshot;
+        EXPECT_ZERO_ALLOCATIONS(snapshot = config);
+        REQUIRE(snapshot.SharesWith(config));
+        REQUIRE(config.UseCount() == 2);
+
+        config.Mut().values["mode"] = "safe";
+        REQUIRE(Config::copies == 1);
+        REQUIRE(snapshot->values.at("mode") == "fast");
+        REQUIRE(config->values.at("mode") == "safe");
+        REQUIRE(config.IsUnique());
+        REQUIRE(snapshot.IsUnique());
+    }
+
+    SECTION("Unique owner writes in place") {
+        CowPtr<int> value(1);
+        const int* before = value.operator->();
+        EXPECT_ZERO_ALLOCATIONS(value.Mut() = 2);
+        REQUIRE(value.operator->() == before);
+        REQUIRE(*value == 2);
+    }
+
+    SECTION("Equality") {
+        CowPtr<int> first(3);
+        CowPtr<int> second(3);
+        REQUIRE(first == second);
+        second.Mut() = 4;
+        REQUIRE(!(first == second));
+    }
+
+    SECTION("Adopted std::shared_ptr is cloned before writing") {
+        auto std_ptr = std::make_shared<int>(5);
+        CowPtr<int> value{SharedPtr<int, NoWeak>(std_ptr)};
+        REQUIRE(value.UseCount() == 1);
+        REQUIRE(!value.IsUnique());
+
+        value.Mut() = 42;
+        REQUIRE(*std_ptr == 5);
+        REQUIRE(*value == 42);
+        REQUIRE(value.IsUnique());
+    }
+
+    SECTION("Null is rejected") {
+        REQUIRE_THROWS_AS(CowPtr<int>(SharedPtr<int, NoWeak>()), std::invalid_argument);
+    }
+
+    SECTION("Moved-from pointers keep the value") {
+        CowPtr<std::string> text(std::string("abc"));
+        CowPtr<std::string> moved = std::move(text);
+        REQUIRE(*text == "abc");
+        REQUIRE(moved.SharesWith(text));
+        text.Mut() += "d";
+        REQUIRE(*text == "abcd");
+        REQUIRE(*moved == "abc");
+
+        text = std::move(moved);
+        REQUIRE(*moved == "abc");
+        REQUIRE(text.UseCount() == 2);
+    }
+}
+
+TEST_CASE("CowVector") {
+    CowVector<int> numbers{1, 2, 3};
+    CowVector<int> copy = numbers;
+    REQUIRE(copy.SharesWith(numbers));
+
+    copy.PushBack(4);
+    REQUIRE(!copy.SharesWith(numbers));
+    REQUIRE(numbers.Size() == 3);
+    REQUIRE(copy.Size() == 4);
+
+    CowVector<int> other = copy;
+    other.Set(0, 10);
+    REQUIRE(copy[0] == 1);
+    REQUIRE(other[0] == 10);
+
+    CowVector<int> shared = other;
+    shared.Clear();
+    REQUIRE(shared.Empty());
+    REQUIRE(other.Size() == 4);
+
+    int sum = 0;
+    for (int value : numbers) {
+        sum += value;
+    }
+    REQUIRE(sum == 6);
+    REQUIRE(numbers == CowVector<int>{1, 2, 3});
+
+    CowVector<int> moved = std::move(numbers);
+    REQUIRE(numbers.Size() == 3);
+    numbers.PushBack(4);
+    REQUIRE(numbers == copy);
+    REQUIRE(moved.Size() == 3);
+}
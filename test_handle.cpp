@@ -0,0 +1,113 @@
+#include "handle.h"
+
+#include <catch.hpp>
+#include <fcntl.h>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+bool IsOpen(int fd) {
+    return fcntl(fd, F_GETFD) != -1;
+}
+
+struct CountingTraits {
+    using Handle = int;
+
+    static int Null() {
+        return 0;
+    }
+
+    void Close(int) {
+        ++closed;
+    }
+
+    int closed = 0;
+};
+
+}  // namespace
+
+TEST_CASE("UniqueHandle") {
+    int fds[2];
+    REQUIRE(pipe(fds) == 0);
+
+    SECTION("Size") {
+        static_assert(sizeof(UniqueFd) == sizeof(int));
+        static_assert(sizeof(UniqueMmapRegion) == sizeof(MmapRegion));
+        static_assert(!std::is_copy_constructible_v<UniqueFd>);
+        static_assert(std::is_nothrow_move_constructible_v<UniqueFd>);
+        close(fds[0]);
+        close(fds[1]);
+    }
+
+    SECTION("Closes on destruction") {
+        {
+            UniqueFd read_end(fds[0]);
+            UniqueFd write_end(fds[1]);
+            REQUIRE(read_end);
+            REQUIRE(write_end.Get() == fds[1]);
+        }
+        REQUIRE(!IsOpen(fds[0]));
+        REQUIRE(!IsOpen(fds[1]));
+    }
+
+    SECTION("Move and release") {
+        UniqueFd a(fds[0]);
+        UniqueFd b(std::move(a));
+        REQUIRE(!a);
+        REQUIRE(a.Get() == -1);
+
+        a = UniqueFd(fds[1]);
+        b = std::move(a);
+        REQUIRE(!IsOpen(fds[0]));
+        REQUIRE(IsOpen(fds[1]));
+
+        int raw = b.Release();
+        REQUIRE(!b);
+        REQUIRE(close(raw) == 0);
+    }
+
+    SECTION("Stateful traits") {
+        UniqueHandle<CountingTraits> handle(5);
+        handle.Reset(6);
+        handle.Reset();
+        REQUIRE(handle.GetTraits().closed == 2);
+        close(fds[0]);
+        close(fds[1]);
+    }
+}
+
+TEST_CASE("UniqueMmapRegion") {
+    size_t length = sysconf(_SC_PAGESIZE);
+    void* address = mmap(nullptr, length, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    REQUIRE(address != MAP_FAILED);
+    {
+        UniqueMmapRegion region(MmapRegion{address, length});
+        REQUIRE(region.Get().length == length);
+    }
+    unsigned char residency;
+    REQUIRE(mincore(address, length, &residency) == -1);
+}
+
+TEST_CASE("SharedHandle") {
+    int fds[2];
+    REQUIRE(pipe(fds) == 0);
+    close(fds[1]);
+
+    SharedFd copy;
+    {
+        SharedFd fd(fds[0]);
+        copy = fd;
+        REQUIRE(fd.UseCount() == 2);
+    }
+    REQUIRE(copy.Get() == fds[0]);
+    REQUIRE(IsOpen(fds[0]));
+
+    copy.Reset();
+    REQUIRE(!copy);
+    REQUIRE(copy.Get() == -1);
+    REQUIRE(!IsOpen(fds[0]));
+
+    SharedFd empty(UniqueFd{});
+    REQUIRE(empty.UseCount() == 0);
+}
@@ -0,0 +1,65 @@
+#include "hugepage_arena.h"
+
+#include <common/my_int.h>
+
+#include <catch.hpp>
+#include <cstdint>
+#include <string>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("Arena allocation") {
+    HugePageArena arena;
+    REQUIRE(arena.GetRegionCount() == 0);
+
+    void* first = arena.Allocate(24);
+    void* second = arena.Allocate(24);
+    REQUIRE(arena.GetRegionCount() == 1);
+    REQUIRE(reinterpret_cast<uintptr_t>(first) % HugePageArena::kRegionSize == 0);
+    REQUIRE(static_cast<char*>(second) - static_cast<char*>(first) == 32);
+
+    arena.Deallocate(first, 24);
+    REQUIRE(arena.Allocate(32) == first);
+
+    void* big = arena.Allocate(HugePageArena::kRegionSize);
+    arena.Deallocate(big, HugePageArena::kRegionSize);
+    REQUIRE(arena.GetRegionCount() == 1);
+}
+
+TEST_CASE("MakeSharedInArena") {
+    HugePageArena arena;
+
+    SECTION("Lifetime") {
+        {
+            auto a = MakeSharedInArena<MyInt>(arena, 42);
+            SharedPtr<MyInt> b = a;
+            REQUIRE(*b == 42);
+            REQUIRE(a.UseCount() == 2);
+            REQUIRE(MyInt::AliveCount() == 1);
+        }
+        REQUIRE(MyInt::AliveCount() == 0);
+    }
+
+    SECTION("Weak pins the block") {
+        WeakPtr<std::string> weak;
+        {
+            auto shared = MakeSharedInArena<std::string>(arena, "aba");
+            weak = shared;
+        }
+        REQUIRE(weak.Expired());
+    }
+
+    SECTION("Freed blocks are reused") {
+        MyInt* first = MakeSharedInArena<MyInt>(arena, 1).Get();
+        MyInt* second = MakeSharedInArena<MyInt>(arena, 2).Get();
+        REQUIRE(first == second);
+    }
+
+    SECTION("Adopt") {
+        {
+            auto ptr = AdoptInArena(arena, new MyInt(5));
+            REQUIRE(*ptr == 5);
+        }
+        REQUIRE(MyInt::AliveCount() == 0);
+    }
+}
@@ -0,0 +1,153 @@
+#include "intrusive.h"
+#include "intrusive_weak.h"
+
+#include <catch.hpp>
+
+#include "allocations_checker.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+struct Node : SimpleRefCounted<Node> {
+    explicit Node(int value = 0) : value(value) {
+        ++alive;
+    }
+
+    Node(const Node& other) : SimpleRefCounted<Node>(other), value(other.value) {
+        ++alive;
+    }
+
+    ~Node() {
+        --alive;
+    }
+
+    int value;
+    static int alive;
+};
+
+int Node::alive = 0;
+
+struct Derived : Node {};
+
+struct GraphNode : WeakRefCounted<GraphNode> {
+    explicit GraphNode(int value = 0) : value(value) {
+        ++alive;
+    }
+
+    ~GraphNode() {
+        --alive;
+    }
+
+    int value;
+    IntrusiveWeakPtr<GraphNode> parent;
+    static int alive;
+};
+
+int GraphNode::alive = 0;
+
+}  // namespace
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("IntrusivePtr") {
+    SECTION("Empty") {
+        IntrusivePtr<Node> ptr;
+        REQUIRE(!ptr);
+        REQUIRE(ptr.UseCount() == 0);
+        REQUIRE(ptr.Get() == nullptr);
+    }
+
+    SECTION("Copy/move") {
+        Node::alive = 0;
+        {
+            auto ptr = MakeIntrusive<Node>(3);
+            IntrusivePtr<Node> copy = ptr;
+            REQUIRE(ptr.UseCount() == 2);
+            IntrusivePtr<Node> moved = std::move(copy);
+            REQUIRE(!copy);
+            REQUIRE(moved.UseCount() == 2);
+            moved = ptr;
+            REQUIRE(ptr.UseCount() == 2);
+            REQUIRE(moved->value == 3);
+        }
+        REQUIRE(Node::alive == 0);
+    }
+
+    SECTION("Raw pointers share the count") {
+        Node::alive = 0;
+        Node* raw = new Node(1);
+        IntrusivePtr<Node> first(raw);
+        IntrusivePtr<Node> second(raw);
+        REQUIRE(first.UseCount() == 2);
+        first.Reset();
+        REQUIRE(Node::alive == 1);
+        second.Reset(new Node(2));
+        REQUIRE(Node::alive == 1);
+        REQUIRE(second->value == 2);
+    }
+
+    SECTION("Copying the object does not copy the count") {
+        auto ptr = MakeIntrusive<Node>(4);
+        auto copy = MakeIntrusive<Node>(*ptr);
+        REQUIRE(copy.UseCount() == 1);
+        REQUIRE(copy->value == 4);
+    }
+
+    SECTION("Upcast") {
+        IntrusivePtr<Node> base = MakeIntrusive<Derived>();
+        REQUIRE(base.UseCount() == 1);
+        IntrusivePtr<Derived> derived = MakeIntrusive<Derived>();
+        base = derived;
+        REQUIRE(base == derived);
+        REQUIRE(derived.UseCount() == 2);
+    }
+}
+
+TEST_CASE("IntrusiveWeakPtr") {
+    SECTION("No side table until the first weak reference") {
+        static_assert(sizeof(SideTableCounter) == sizeof(SimpleCounter));
+        auto node = MakeIntrusive<GraphNode>(1);
+        IntrusivePtr<GraphNode> copy;
+        EXPECT_ZERO_ALLOCATIONS(copy = node);
+        REQUIRE(node.UseCount() == 2);
+        REQUIRE(!node->GetCounter().HasSideTable());
+
+        IntrusiveWeakPtr<GraphNode> weak;
+        EXPECT_ONE_ALLOCATION(weak = node);
+        REQUIRE(node->GetCounter().HasSideTable());
+        REQUIRE(weak.UseCount() == 2);
+        REQUIRE(node->GetCounter().GetSideTable()->WeakCount() == 1);
+        EXPECT_ZERO_ALLOCATIONS(IntrusiveWeakPtr<GraphNode> another(node));
+    }
+
+    SECTION("Lock and expiry") {
+        GraphNode::alive = 0;
+        IntrusiveWeakPtr<GraphNode> weak;
+        {
+            auto node = MakeIntrusive<GraphNode>(2);
+            weak = node;
+            auto locked = weak.Lock();
+            REQUIRE(locked->value == 2);
+            REQUIRE(node.UseCount() == 2);
+        }
+        REQUIRE(GraphNode::alive == 0);
+        REQUIRE(weak.Expired());
+        REQUIRE(!weak.Lock());
+        IntrusiveWeakPtr<GraphNode> copy = weak;
+        weak.Reset();
+        REQUIRE(copy.UseCount() == 0);
+    }
+
+    SECTION("Back references do not keep the graph alive") {
+        GraphNode::alive = 0;
+        {
+            auto root = MakeIntrusive<GraphNode>(0);
+            auto child = MakeIntrusive<GraphNode>(1);
+            child->parent = root;
+            REQUIRE(child->parent.Lock() == root);
+            REQUIRE(root.UseCount() == 1);
+        }
+        REQUIRE(GraphNode::alive == 0);
+    }
+}
@@ -0,0 +1,175 @@
+#include "intrusive_list.h"
+#include "intrusive_tree.h"
+
+#include <catch.hpp>
+
+#include "allocations_checker.h"
+
+#include <map>
+#include <random>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+struct LruTag {};
+struct ReadyTag {};
+struct TimerTag {};
+
+// One connection in a timer tree, an LRU list and a ready list at the same time
+struct Connection : SimpleRefCounted<Connection>,
+                    IntrusiveListHook<LruTag>,
+                    IntrusiveListHook<ReadyTag>,
+                    IntrusiveTreeHook<TimerTag> {
+    explicit Connection(int id, int deadline = 0) : id(id), deadline(deadline) {
+        ++alive;
+    }
+
+    ~Connection() {
+        --alive;
+    }
+
+    int id;
+    int deadline;
+    static int alive;
+};
+
+int Connection::alive = 0;
+
+struct ByDeadline {
+    bool operator()(const Connection& left, const Connection& right) const {
+        return left.deadline < right.deadline;
+    }
+    bool operator()(const Connection& left, int deadline) const {
+        return left.deadline < deadline;
+    }
+};
+
+using LruList = IntrusiveList<Connection, LruTag>;
+using ReadyList = IntrusiveList<Connection, ReadyTag>;
+using TimerTree = IntrusiveTree<Connection, ByDeadline, TimerTag>;
+
+template <typename Container>
+std::vector<int> Ids(const Container& container) {
+    std::vector<int> ids;
+    for (const Connection& connection : container) {
+        ids.push_back(connection.id);
+    }
+    return ids;
+}
+
+}  // namespace
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("IntrusiveList") {
+    SECTION("Order and ownership") {
+        Connection::alive = 0;
+        {
+            LruList lru;
+            lru.PushBack(MakeIntrusive<Connection>(1));
+            lru.PushBack(MakeIntrusive<Connection>(2));
+            lru.PushFront(MakeIntrusive<Connection>(0));
+            REQUIRE(Ids(lru) == std::vector<int>{0, 1, 2});
+            REQUIRE(lru.Size() == 3);
+            REQUIRE(Connection::alive == 3);
+
+            lru.MoveToBack(lru.Front());
+            REQUIRE(Ids(lru) == std::vector<int>{1, 2, 0});
+            lru.MoveToFront(lru.Back());
+            REQUIRE(Ids(lru) == std::vector<int>{0, 1, 2});
+
+            IntrusivePtr<Connection> first = lru.PopFront();
+            REQUIRE(first->id == 0);
+            REQUIRE(first.UseCount() == 1);
+            REQUIRE(!static_cast<IntrusiveListHook<LruTag>&>(*first).IsLinked());
+            lru.Erase(lru.Back());
+            REQUIRE(Connection::alive == 2);
+        }
+        REQUIRE(Connection::alive == 0);
+    }
+
+    SECTION("Several lists, no allocations") {
+        LruList lru;
+        ReadyList ready;
+        auto connection = MakeIntrusive<Connection>(7);
+        EXPECT_ZERO_ALLOCATIONS({
+            lru.PushBack(connection);
+            ready.PushBack(connection);
+            REQUIRE(connection.UseCount() == 3);
+            ready.Erase(*connection);
+            lru.MoveToFront(*connection);
+        });
+        REQUIRE(connection.UseCount() == 2);
+        REQUIRE(!ready.PopBack());
+        REQUIRE(lru.PopBack() == connection);
+    }
+}
+
+TEST_CASE("IntrusiveTree") {
+    SECTION("Timer queue") {
+        Connection::alive = 0;
+        {
+            TimerTree timers;
+            timers.Insert(MakeIntrusive<Connection>(1, 30));
+            timers.Insert(MakeIntrusive<Connection>(2, 10));
+            timers.Insert(MakeIntrusive<Connection>(3, 20));
+            timers.Insert(MakeIntrusive<Connection>(4, 10));
+            REQUIRE(Ids(timers) == std::vector<int>{2, 4, 3, 1});
+            REQUIRE(timers.LowerBound(15)->id == 3);
+            REQUIRE(timers.LowerBound(31) == timers.end());
+            REQUIRE((--timers.end())->id == 1);
+
+            timers.Front().deadline = 40;
+            timers.Update(timers.Front());
+            REQUIRE(Ids(timers) == std::vector<int>{4, 3, 1, 2});
+            REQUIRE(timers.PopFront()->id == 4);
+            REQUIRE(Connection::alive == 3);
+        }
+        REQUIRE(Connection::alive == 0);
+    }
+
+    SECTION("Matches std::multimap") {
+        std::mt19937 random(42);
+        TimerTree timers;
+        std::multimap<int, IntrusivePtr<Connection>> reference;
+        for (int i = 0; i < 5000; ++i) {
+            if (reference.empty() || random() % 3 != 0) {
+                auto connection = MakeIntrusive<Connection>(i, random() % 100);
+                timers.Insert(connection);
+                reference.emplace(connection->deadline, connection);
+            } else {
+                auto it = reference.lower_bound(random() % 100);
+                if (it == reference.end()) {
+                    it = reference.begin();
+                }
+                timers.Erase(*it->second);
+                reference.erase(it);
+            }
+            REQUIRE(timers.Size() == reference.size());
+        }
+        std::vector<int> expected;
+        for (const auto& [deadline, connection] : reference) {
+            expected.push_back(connection->deadline);
+        }
+        std::vector<int> deadlines;
+        for (const Connection& connection : timers) {
+            deadlines.push_back(connection.deadline);
+        }
+        REQUIRE(deadlines == expected);
+    }
+
+    SECTION("Tree and lists together") {
+        TimerTree timers;
+        LruList lru;
+        auto connection = MakeIntrusive<Connection>(1, 5);
+        EXPECT_ZERO_ALLOCATIONS({
+            timers.Insert(connection);
+            lru.PushBack(connection);
+            timers.Erase(*connection);
+        });
+        REQUIRE(connection.UseCount() == 2);
+        REQUIRE(timers.Empty());
+    }
+}
@@ -0,0 +1,118 @@
+#include "large_alloc.h"
+#include "weak.h"
+
+#include <common/my_int.h>
+
+#include <catch.hpp>
+#include <cerrno>
+#include <cstdint>
+#include <unistd.h>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+struct Big {
+    explicit Big(int value = 0) {
+        data[0] = value;
+    }
+
+    int data[kDirectMmapThreshold / sizeof(int)];
+};
+
+bool IsMapped(const void* ptr) {
+    static const auto page_size = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+    auto page = reinterpret_cast<uintptr_t>(ptr) / page_size * page_size;
+    unsigned char residency;
+    return mincore(reinterpret_cast<void*>(page), 1, &residency) == 0 || errno != ENOMEM;
+}
+
+}  // namespace
+
+TEST_CASE("MakeSharedLarge") {
+    SECTION("Small objects use MakeShared") {
+        auto ptr = MakeSharedLarge<MyInt>(3);
+        REQUIRE(*ptr == 3);
+        REQUIRE(MyInt::AliveCount() == 1);
+    }
+
+    SECTION("Mapping is released with the last strong reference") {
+        WeakPtr<Big> weak;
+        Big* raw;
+        {
+            auto ptr = MakeSharedLarge<Big>(42);
+            SharedPtr<Big> copy = ptr;
+            raw = ptr.Get();
+            weak = ptr;
+
+            REQUIRE(copy->data[0] == 42);
+            REQUIRE(reinterpret_cast<uintptr_t>(raw) % sysconf(_SC_PAGESIZE) == 0);
+            REQUIRE(IsMapped(raw));
+        }
+        REQUIRE(weak.Expired());
+        REQUIRE(!IsMapped(raw));
+    }
+
+    SECTION("Array") {
+        const size_t size = kDirectMmapThreshold / sizeof(int64_t) * 2;
+        WeakPtr<int64_t> weak;
+        int64_t* raw;
+        {
+            SharedPtr<int64_t> arr = MakeSharedLarge<int64_t[]>(size);
+            raw = arr.Get();
+            weak = arr;
+            REQUIRE(raw[size - 1] == 0);
+            REQUIRE(IsMapped(raw));
+        }
+        REQUIRE(weak.Expired());
+        REQUIRE(!IsMapped(raw));
+
+        SharedPtr<MyInt> small = MakeSharedLarge<MyInt[]>(3);
+        REQUIRE(MyInt::AliveCount() == 3);
+    }
+
+    REQUIRE(MyInt::AliveCount() == 0);
+}
+
+TEST_CASE("MakeUniqueLarge") {
+    SECTION("Object") {
+        auto ptr = MakeUniqueLarge<Big>(7);
+        Big* raw = ptr.Get();
+        REQUIRE(ptr->data[0] == 7);
+        REQUIRE(ptr.GetDeleter().GetLength() == sizeof(Big));
+
+        ptr.Reset();
+        REQUIRE(!IsMapped(raw));
+    }
+
+    SECTION("Array") {
+        const size_t size = kDirectMmapThreshold / sizeof(int64_t) * 2;
+        auto arr = MakeUniqueLarge<int64_t[]>(size);
+        REQUIRE(arr[0] == 0);
+        REQUIRE(arr[size - 1] == 0);
+        REQUIRE(arr.GetDeleter().GetLength() == size * sizeof(int64_t));
+
+        int64_t* raw = arr.Get();
+        arr = nullptr;
+        REQUIRE(!IsMapped(raw));
+    }
+
+    SECTION("Array of non-trivial elements") {
+        const size_t size = kDirectMmapThreshold / sizeof(std::vector<int>) + 1;
+        {
+            auto arr = MakeUniqueLarge<std::vector<int>[]>(size);
+            arr[size - 1].push_back(1);
+            REQUIRE(arr.GetDeleter().GetLength() != 0);
+        }
+        auto small = MakeUniqueLarge<MyInt[]>(3);
+        REQUIRE(small.GetDeleter().GetLength() == 0);
+        REQUIRE(MyInt::AliveCount() == 3);
+    }
+
+    SECTION("Array size overflow") {
+        REQUIRE_THROWS_AS(MakeUniqueLarge<int64_t[]>(SIZE_MAX / 4), std::bad_array_new_length);
+    }
+
+    REQUIRE(MyInt::AliveCount() == 0);
+}
@@ -0,0 +1,73 @@
+#include "mapping.h"
+
+#include <catch.hpp>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <numeric>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+std::string WriteTempFile(const std::vector<int32_t>& data) {
+    std::string path = "test_mapping_" + std::to_string(getpid()) + ".bin";
+    std::ofstream out(path, std::ios::binary);
+    out.write(reinterpret_cast<const char*>(data.data()), data.size() * sizeof(int32_t));
+    return path;
+}
+
+}  // namespace
+
+TEST_CASE("UniqueMapping") {
+    std::vector<int32_t> data(10000);
+    std::iota(data.begin(), data.end(), 0);
+    std::string path = WriteTempFile(data);
+
+    SECTION("Read only") {
+        auto mapping = UniqueMapping<const int32_t>::Open(path);
+        mapping.Sequential();
+        mapping.Prefetch(5000, 100);
+
+        REQUIRE(mapping.Size() == data.size());
+        REQUIRE(std::equal(data.begin(), data.end(), mapping.Span().begin()));
+
+        UniqueMapping<const int32_t> moved = std::move(mapping);
+        REQUIRE(!mapping);
+        REQUIRE(moved[9999] == 9999);
+    }
+
+    SECTION("Read write") {
+        {
+            auto mapping = UniqueMapping<int32_t>::Open(path, MappingMode::kReadWrite);
+            mapping[3] = -3;
+            mapping.WillNeed();
+        }
+        auto mapping = UniqueMapping<const int32_t>::Open(path);
+        REQUIRE(mapping[3] == -3);
+        REQUIRE_THROWS_AS(UniqueMapping<const int32_t>::Open(path, MappingMode::kReadWrite),
+                          std::system_error);
+    }
+
+    SECTION("Shared slices") {
+        SharedMapping<const int32_t> slice;
+        {
+            auto shared = UniqueMapping<const int32_t>::Open(path).Share();
+            slice = shared.Slice(100, 50);
+            REQUIRE(shared.UseCount() == 2);
+            REQUIRE_THROWS_AS(shared.Slice(9990, 11), std::out_of_range);
+        }
+        REQUIRE(slice.UseCount() == 1);
+        REQUIRE(slice.Size() == 50);
+        REQUIRE(slice[0] == 100);
+        REQUIRE(slice.Span().back() == 149);
+        slice.DontNeed();
+    }
+
+    SECTION("Missing file") {
+        REQUIRE_THROWS_AS(UniqueMapping<char>::Open(path + ".missing"), std::system_error);
+    }
+
+    std::remove(path.c_str());
+}
@@ -0,0 +1,101 @@
+#include "memory_accounting.h"
+
+#include <common/my_int.h>
+
+#include <catch.hpp>
+#include <thread>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+constexpr MemoryCategory kParser{1};
+constexpr MemoryCategory kCache{2};
+constexpr MemoryCategory kTenant{3};
+
+TEST_CASE("Accounted MakeShared") {
+    const size_t block_size = sizeof(AccountedControlBlockHolder<MyInt>);
+    {
+        auto a = MakeShared<MyInt>(kParser, 42);
+        SharedPtr<MyInt> b = a;
+        auto c = MakeShared<MyInt>(kParser);
+
+        REQUIRE(*b == 42);
+        REQUIRE(MyInt::AliveCount() == 2);
+        REQUIRE(MemoryAccounting::GetUsage(kParser).current_bytes == 2 * block_size);
+    }
+    REQUIRE(MyInt::AliveCount() == 0);
+
+    MemoryUsage usage = MemoryAccounting::GetUsage(kParser);
+    REQUIRE(usage.current_bytes == 0);
+    REQUIRE(usage.sampled_peak_bytes == 2 * block_size);
+}
+
+TEST_CASE("Accounted block outlives the object") {
+    WeakPtr<int> weak;
+    {
+        auto shared = MakeShared<int>(kCache, 1);
+        weak = shared;
+    }
+    REQUIRE(MemoryAccounting::GetUsage(kCache).current_bytes ==
+            sizeof(AccountedControlBlockHolder<int>));
+    weak.Reset();
+    REQUIRE(MemoryAccounting::GetUsage(kCache).current_bytes == 0);
+}
+
+TEST_CASE("Accounted MakeUnique") {
+    MemoryCategory category{4};
+
+    auto object = MakeUnique<MyInt>(category, 7);
+    auto array = MakeUnique<int[]>(category, 10);
+    REQUIRE(*object == 7);
+    REQUIRE(array[9] == 0);
+    REQUIRE(MemoryAccounting::GetUsage(category).current_bytes ==
+            sizeof(MyInt) + 10 * sizeof(int));
+
+    UniquePtr<MyInt, AccountedDeleter<MyInt>> moved = std::move(object);
+    moved.Reset();
+    array = nullptr;
+    REQUIRE(MemoryAccounting::GetUsage(category).current_bytes == 0);
+
+    auto untagged = MakeUnique<MyInt>(5);
+    REQUIRE(MemoryAccounting::GetUsage(MemoryCategory{}).current_bytes == 0);
+}
+
+namespace {
+
+struct Base {
+    virtual ~Base() = default;
+};
+
+struct Derived : Base {
+    char payload[100] = {};
+};
+
+}  // namespace
+
+TEST_CASE("Accounted MakeUnique converted to base") {
+    MemoryCategory category{5};
+    UniquePtr<Base, AccountedDeleter<Base>> base = MakeUnique<Derived>(category);
+    REQUIRE(base.GetDeleter().GetBytes() == sizeof(Derived));
+    REQUIRE(MemoryAccounting::GetUsage(category).current_bytes == sizeof(Derived));
+
+    base.Reset();
+    REQUIRE(MemoryAccounting::GetUsage(category).current_bytes == 0);
+}
+
+TEST_CASE("Category id is checked") {
+    REQUIRE_NOTHROW(MemoryCategory{MemoryCategory::kMaxCategories - 1});
+    REQUIRE_THROWS_AS(MemoryCategory{MemoryCategory::kMaxCategories}, std::out_of_range);
+}
+
+TEST_CASE("Per-thread counters are aggregated") {
+    SharedPtr<int> from_thread;
+    std::thread worker([&from_thread] { from_thread = MakeShared<int>(kTenant, 3); });
+    worker.join();
+
+    const auto block_size = static_cast<int64_t>(sizeof(AccountedControlBlockHolder<int>));
+    REQUIRE(MemoryAccounting::GetUsage(kTenant).current_bytes == block_size);
+
+    from_thread.Reset();  // credited on this thread
+    REQUIRE(MemoryAccounting::GetUsage(kTenant).current_bytes == 0);
+    REQUIRE(MemoryAccounting::GetUsage(kTenant).sampled_peak_bytes == block_size);
+}
@@ -0,0 +1,213 @@
+#include "persistent.h"
+
+#include <catch.hpp>
+
+#include "allocations_checker.h"
+
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+// Every key lands in the same trie path
+struct CollidingHash {
+    size_t operator()(int) const {
+        return 7;
+    }
+};
+
+template <typename T>
+std::vector<T> ToVector(const PersistentVector<T>& vector) {
+    return std::vector<T>(vector.begin(), vector.end());
+}
+
+}  // namespace
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("PersistentVector") {
+    SECTION("Versions are independent") {
+        PersistentVector<int> empty;
+        auto one = empty.PushBack(1);
+        auto two = one.PushBack(2);
+        auto changed = two.Set(0, 10);
+        REQUIRE(empty.Empty());
+        REQUIRE(ToVector(one) == std::vector<int>{1});
+        REQUIRE(ToVector(two) == std::vector<int>{1, 2});
+        REQUIRE(ToVector(changed) == std::vector<int>{10, 2});
+        REQUIRE(ToVector(changed.PopBack()) == std::vector<int>{10});
+        REQUIRE_THROWS_AS(two.Set(2, 0), std::out_of_range);
+        REQUIRE_THROWS_AS(empty.PopBack(), std::out_of_range);
+
+        auto transient = empty.Transient();
+        REQUIRE_THROWS_AS(transient.PopBack(), std::out_of_range);
+        REQUIRE_THROWS_AS(transient.Set(0, 1), std::out_of_range);
+        REQUIRE(transient.Size() == 0);
+    }
+
+    SECTION("Grows and shrinks through several levels") {
+        const int size = 40000;
+        auto transient = PersistentVector<int>().Transient();
+        for (int i = 0; i < size; ++i) {
+            transient.PushBack(i);
+        }
+        PersistentVector<int> full = std::move(transient).Persistent();
+        REQUIRE(full.Size() == size);
+        for (int i = 0; i < size; i += 997) {
+            REQUIRE(full[i] == i);
+        }
+
+        auto shrinking = full.Transient();
+        while (shrinking.Size() > 1) {
+            shrinking.PopBack();
+            REQUIRE(shrinking[shrinking.Size() - 1] == int(shrinking.Size()) - 1);
+        }
+        shrinking.PopBack();
+        REQUIRE(shrinking.Size() == 0);
+        REQUIRE(full[size - 1] == size - 1);
+    }
+
+    SECTION("Matches std::vector") {
+        std::mt19937 random(7);
+        std::vector<std::string> reference;
+        PersistentVector<std::string> vector;
+        std::vector<PersistentVector<std::string>> history;
+        for (int i = 0; i < 3000; ++i) {
+            auto choice = random() % 4;
+            if (reference.empty() || choice < 2) {
+                reference.push_back(std::to_string(i));
+                vector = vector.PushBack(std::to_string(i));
+            } else if (choice == 2) {
+                size_t index = random() % reference.size();
+                reference[index] = "x";
+                vector = vector.Set(index, "x");
+            } else {
+                reference.pop_back();
+                vector = vector.PopBack();
+            }
+            if (i % 500 == 0) {
+                history.push_back(vector);
+            }
+        }
+        REQUIRE(ToVector(vector) == reference);
+        REQUIRE(history.front().Size() == 1);
+    }
+
+    SECTION("Updates copy only the path") {
+        auto transient = PersistentVector<int>().Transient();
+        for (int i = 0; i < 32 * 32 * 4; ++i) {
+            transient.PushBack(i);
+        }
+        auto base = std::move(transient).Persistent();
+        auto updated = base.Set(100, -1);
+        REQUIRE(updated[100] == -1);
+        REQUIRE(base[100] == 100);
+
+        auto small = PersistentVector<int>().PushBack(1).PushBack(2);
+        PersistentVector<int> small_updated;
+        EXPECT_ONE_ALLOCATION(small_updated = small.Set(0, 3));  // the single leaf
+
+        // The transient owns its copy of the path now: further writes there are in place
+        auto batch = updated.Transient();
+        updated = PersistentVector<int>();
+        EXPECT_ZERO_ALLOCATIONS(batch.Set(101, -2));
+        REQUIRE(batch[100] == -1);
+    }
+
+    SECTION("Moved-from vectors are empty") {
+        auto transient = PersistentVector<int>().Transient();
+        for (int i = 0; i < 40; ++i) {
+            transient.PushBack(i);
+        }
+        auto vector = std::move(transient).Persistent();
+        REQUIRE(transient.Size() == 0);
+        transient.PushBack(5);
+        REQUIRE(transient[0] == 5);
+
+        auto moved = std::move(vector);
+        REQUIRE(moved.Size() == 40);
+        REQUIRE(vector.Empty());
+        REQUIRE_THROWS_AS(vector.PopBack(), std::out_of_range);
+        vector = vector.PushBack(7);
+        REQUIRE(ToVector(vector) == std::vector<int>{7});
+
+        moved = std::move(vector);
+        REQUIRE(vector.Empty());
+        REQUIRE(ToVector(moved) == std::vector<int>{7});
+    }
+}
+
+TEST_CASE("PersistentMap") {
+    SECTION("Versions are independent") {
+        PersistentMap<std::string, int> empty;
+        auto one = empty.Set("a", 1);
+        auto two = one.Set("b", 2);
+        auto changed = two.Set("a", 10);
+        REQUIRE(empty.Find("a") == nullptr);
+        REQUIRE(*one.Find("a") == 1);
+        REQUIRE(two.Size() == 2);
+        REQUIRE(*changed.Find("a") == 10);
+        REQUIRE(*two.Find("a") == 1);
+
+        auto erased = changed.Erase("b");
+        REQUIRE(!erased.Contains("b"));
+        REQUIRE(changed.Contains("b"));
+        REQUIRE(erased.Erase("missing").Size() == 1);
+    }
+
+    SECTION("Matches std::unordered_map") {
+        std::mt19937 random(11);
+        std::unordered_map<int, int> reference;
+        auto transient = PersistentMap<int, int>().Transient();
+        for (int i = 0; i < 20000; ++i) {
+            int key = random() % 4000;
+            if (random() % 3 == 0) {
+                REQUIRE(transient.Erase(key) == (reference.erase(key) == 1));
+            } else {
+                REQUIRE(transient.Set(key, i) == (reference.count(key) == 0));
+                reference[key] = i;
+            }
+        }
+        auto map = std::move(transient).Persistent();
+        REQUIRE(map.Size() == reference.size());
+        size_t visited = 0;
+        map.ForEach([&](int key, int value) {
+            REQUIRE(reference.at(key) == value);
+            ++visited;
+        });
+        REQUIRE(visited == reference.size());
+    }
+
+    SECTION("Full hash collisions") {
+        PersistentMap<int, int, CollidingHash> map;
+        for (int i = 0; i < 10; ++i) {
+            map = map.Set(i, i * i);
+        }
+        auto smaller = map.Erase(3).Erase(4);
+        REQUIRE(map.Size() == 10);
+        REQUIRE(smaller.Size() == 8);
+        REQUIRE(!smaller.Contains(3));
+        REQUIRE(*smaller.Find(9) == 81);
+        REQUIRE(*map.Find(3) == 9);
+    }
+
+    SECTION("Moved-from maps are empty") {
+        auto map = PersistentMap<int, int>().Set(1, 1).Set(2, 4);
+        auto moved = std::move(map);
+        REQUIRE(moved.Size() == 2);
+        REQUIRE(map.Size() == 0);
+        REQUIRE(map.Find(1) == nullptr);
+        map = map.Set(3, 9);
+        REQUIRE(map.Size() == 1);
+
+        auto transient = moved.Transient();
+        moved = std::move(transient).Persistent();
+        REQUIRE(transient.Size() == 0);
+        REQUIRE(transient.Set(1, 2));
+        REQUIRE(*moved.Find(2) == 4);
+    }
+}
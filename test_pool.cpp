@@ -0,0 +1,95 @@
+#include "pool.h"
+
+#include <common/my_int.h>
+
+#include <catch.hpp>
+
+#include "allocations_checker.h"
+
+#include <string>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+struct Buffer {
+    void Reset() {
+        data.clear();
+        ++resets;
+    }
+
+    std::string data;
+    int resets = 0;
+};
+
+}  // namespace
+
+TEST_CASE("Pooled UniquePtr") {
+    ObjectPool<Buffer> pool;
+    Buffer* first;
+    {
+        auto buffer = pool.Acquire();
+        buffer->data = "payload";
+        first = buffer.Get();
+    }
+    REQUIRE(pool.GetPooledCount() == 1);
+
+    auto again = pool.Acquire();
+    REQUIRE(again.Get() == first);
+    REQUIRE(again->data.empty());
+    REQUIRE(again->resets == 1);
+    REQUIRE(pool.GetPooledCount() == 0);
+}
+
+TEST_CASE("Pooled SharedPtr") {
+    ObjectPool<Buffer> pool;
+
+    SECTION("Returns with the last reference") {
+        SharedPtr<Buffer> copy;
+        {
+            auto buffer = pool.AcquireShared();
+            copy = buffer;
+        }
+        REQUIRE(pool.GetPooledCount() == 0);
+        copy.Reset();
+        REQUIRE(pool.GetPooledCount() == 1);
+    }
+
+    SECTION("Weak references keep the block") {
+        WeakPtr<Buffer> weak;
+        {
+            auto buffer = pool.AcquireShared();
+            weak = buffer;
+        }
+        REQUIRE(weak.Expired());
+        REQUIRE(pool.GetPooledCount() == 1);
+    }
+
+    SECTION("No allocations when warm") {
+        pool.AcquireShared();
+        EXPECT_ZERO_ALLOCATIONS({
+            auto buffer = pool.AcquireShared();
+            SharedPtr<Buffer> copy = buffer;
+        });
+    }
+}
+
+TEST_CASE("Pool cap and reset hook") {
+    int hook_calls = 0;
+    {
+        ObjectPool<MyInt> pool(1, [&hook_calls](MyInt&) { ++hook_calls; });
+        pool.Reserve(5);
+        REQUIRE(pool.GetPooledCount() == 1);
+
+        {
+            auto a = pool.Acquire();
+            auto b = pool.Acquire();
+            auto c = pool.AcquireShared();
+            REQUIRE(MyInt::AliveCount() == 3);
+        }
+        REQUIRE(pool.GetPooledCount() == 1);
+        REQUIRE(MyInt::AliveCount() == 1);
+        REQUIRE(hook_calls == 1);
+    }
+    REQUIRE(MyInt::AliveCount() == 0);
+}
@@ -0,0 +1,122 @@
+#include "retain.h"
+
+#include <catch.hpp>
+
+#include "allocations_checker.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+// C-style object with its own reference count
+struct CObject {
+    int refs = 1;
+    int value = 0;
+};
+
+int destroyed = 0;
+
+CObject* CObjectNew(int value) {
+    return new CObject{1, value};
+}
+
+void CObjectRef(CObject* object) {
+    ++object->refs;
+}
+
+void CObjectUnref(CObject* object) {
+    if (--object->refs == 0) {
+        ++destroyed;
+        delete object;
+    }
+}
+
+struct CObjectTraits {
+    static void Ref(CObject* object) {
+        CObjectRef(object);
+    }
+
+    static void Unref(CObject* object) {
+        CObjectUnref(object);
+    }
+};
+
+// Stateful traits are kept next to the pointer
+struct CountingTraits {
+    void Ref(CObject* object) {
+        ++*calls;
+        CObjectRef(object);
+    }
+
+    void Unref(CObject* object) {
+        ++*calls;
+        CObjectUnref(object);
+    }
+
+    int* calls;
+};
+
+using CObjectPtr = RetainPtr<CObject, CObjectTraits>;
+
+}  // namespace
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("RetainPtr") {
+    SECTION("Size") {
+        static_assert(sizeof(CObjectPtr) == sizeof(CObject*));
+    }
+
+    SECTION("Adopt and Retain") {
+        destroyed = 0;
+        CObject* raw = CObjectNew(5);
+        {
+            auto owner = CObjectPtr::Adopt(raw);
+            REQUIRE(raw->refs == 1);
+            auto other = CObjectPtr::Retain(raw);
+            REQUIRE(raw->refs == 2);
+            REQUIRE(other == owner);
+            REQUIRE(other->value == 5);
+        }
+        REQUIRE(destroyed == 1);
+    }
+
+    SECTION("Copy and move") {
+        destroyed = 0;
+        auto first = CObjectPtr::Adopt(CObjectNew(1));
+        CObjectPtr copy = first;
+        REQUIRE(first->refs == 2);
+        CObjectPtr moved;
+        EXPECT_ZERO_ALLOCATIONS(moved = std::move(copy));
+        REQUIRE(!copy);
+        REQUIRE(first->refs == 2);
+
+        first = CObjectPtr::Adopt(CObjectNew(2));
+        REQUIRE(moved->refs == 1);
+        moved = first;
+        REQUIRE(destroyed == 1);
+        REQUIRE(first->refs == 2);
+    }
+
+    SECTION("Release hands the reference back") {
+        destroyed = 0;
+        auto owner = CObjectPtr::Adopt(CObjectNew(3));
+        CObject* raw = owner.Release();
+        REQUIRE(!owner);
+        REQUIRE(raw->refs == 1);
+        CObjectUnref(raw);
+        REQUIRE(destroyed == 1);
+        REQUIRE(!CObjectPtr::Retain(nullptr));
+    }
+
+    SECTION("Stateful traits") {
+        int calls = 0;
+        {
+            CObject* raw = CObjectNew(4);
+            auto owner = RetainPtr<CObject, CountingTraits>::Adopt(raw, CountingTraits{&calls});
+            auto copy = owner;
+            REQUIRE(calls == 1);
+        }
+        REQUIRE(calls == 3);
+    }
+}
@@ -0,0 +1,90 @@
+#include "scoped.h"
+
+#include <catch.hpp>
+
+#include "allocations_checker.h"
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <csignal>
+#include <string>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+struct Request : EnableSharedFromThis<Request> {
+    explicit Request(std::string path) : path(std::move(path)) {
+        ++alive;
+    }
+
+    ~Request() {
+        --alive;
+    }
+
+    std::string path;
+    static int alive;
+};
+
+int Request::alive = 0;
+
+size_t Handle(SharedPtr<Request> request) {
+    SharedPtr<Request> copy = request;
+    return copy.UseCount();
+}
+
+// Runs `body` in a child process and reports whether it died of SIGABRT
+template <typename Body>
+bool Aborts(Body body) {
+    pid_t pid = fork();
+    if (pid == 0) {
+        body();
+        _exit(0);
+    }
+    int status = 0;
+    waitpid(pid, &status, 0);
+    return WIFSIGNALED(status) && WTERMSIG(status) == SIGABRT;
+}
+
+}  // namespace
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("ScopedShared") {
+    SECTION("No heap allocations") {
+        EXPECT_ZERO_ALLOCATIONS({
+            ScopedShared<int> value(5);
+            SharedPtr<int> copy = value.Share();
+            REQUIRE(*copy == 5);
+            REQUIRE(value.UseCount() == 2);
+        });
+    }
+
+    SECTION("Object lives for the scope") {
+        {
+            ScopedShared<Request> request("/index");
+            REQUIRE(Request::alive == 1);
+            REQUIRE(Handle(request.Share()) == 3);
+            REQUIRE(request.UseCount() == 1);
+            REQUIRE(request->SharedFromThis().Get() == request.Get());
+            WeakPtr<Request> weak = request.Share();
+            REQUIRE(!weak.Expired());
+        }
+        REQUIRE(Request::alive == 0);
+    }
+
+    SECTION("Escaped references abort") {
+        REQUIRE(!Aborts([] { ScopedShared<int> value(1); }));
+        REQUIRE(Aborts([] {
+            SharedPtr<int> escaped;
+            ScopedShared<int> value(1);
+            escaped = value.Share();
+        }));
+        REQUIRE(Aborts([] {
+            WeakPtr<int> escaped;
+            ScopedShared<int> value(1);
+            escaped = value.Share();
+        }));
+    }
+}
@@ -5,6 +5,8 @@
 #include "allocations_checker.h"
 
 #include <memory>
+#include <unordered_map>
+#include <unordered_set>
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
@@ -467,3 +469,632 @@ TEST_CASE("Destructor for correct type") {
         REQUIRE(B::destructor_called);
     }
 }
+
+struct Counted {
+    static int alive;
+
+    explicit Counted(int value) : value(value) {
+        ++alive;
+    }
+
+    Counted(const Counted& other) : value(other.value) {
+        ++alive;
+    }
+
+    ~Counted() {
+        --alive;
+    }
+
+    int value;
+};
+
+int Counted::alive = 0;
+
+TEST_CASE("MakeSharedBatch") {
+    SECTION("Empty") {
+        REQUIRE(MakeSharedBatch<int>(0).empty());
+    }
+
+    SECTION("One block for the whole batch") {
+        SharedPtr<Counted> survivor;
+        {
+            auto batch = MakeSharedBatch<Counted>(100, 7);
+            REQUIRE(batch.size() == 100);
+            REQUIRE(Counted::alive == 100);
+            for (size_t i = 0; i < batch.size(); ++i) {
+                REQUIRE(batch[i].Get() == batch[0].Get() + i);
+                REQUIRE(batch[i]->value == 7);
+            }
+            REQUIRE(batch[0].UseCount() == 100);
+            survivor = batch[42];
+        }
+        REQUIRE(Counted::alive == 100);
+        REQUIRE(survivor.UseCount() == 1);
+        REQUIRE(survivor->value == 7);
+        survivor.Reset();
+        REQUIRE(Counted::alive == 0);
+    }
+
+    SECTION("Weak references") {
+        WeakPtr<Counted> weak;
+        {
+            auto batch = MakeSharedBatch<Counted>(3, 1);
+            weak = batch[2];
+        }
+        REQUIRE(weak.Expired());
+        REQUIRE(Counted::alive == 0);
+    }
+
+    SECTION("Over-aligned objects") {
+        struct alignas(64) Wide {
+            char data[3];
+        };
+        auto batch = MakeSharedBatch<Wide>(4);
+        for (const auto& wide : batch) {
+            REQUIRE(reinterpret_cast<uintptr_t>(wide.Get()) % 64 == 0);
+        }
+    }
+}
+
+TEST_CASE("MakeSharedTuple") {
+    SECTION("Construction") {
+        auto p_int = std::make_unique<int>(42);
+        Pinned pinned(1312);
+        auto [number, text, d] = MakeSharedTuple<int, std::string, D>(
+            std::make_tuple(5), std::forward_as_tuple(3, 'a'),
+            std::forward_as_tuple(pinned, std::move(p_int)));
+
+        REQUIRE(*number == 5);
+        REQUIRE(*text == "aaa");
+        REQUIRE(d->GetUP() == 42);
+        REQUIRE(d->GetPinned().GetTag() == 1312);
+        REQUIRE(number.UseCount() == 3);
+    }
+
+    SECTION("One allocation") {
+        EXPECT_ONE_ALLOCATION((MakeSharedTuple<int, double, char>()));
+    }
+
+    SECTION("Default construction") {
+        auto [first, second] = MakeSharedTuple<std::string, std::string>();
+        REQUIRE(first->empty());
+        REQUIRE(first.Get() != second.Get());
+    }
+
+    SECTION("Shared lifetime") {
+        Counted::alive = 0;
+        SharedPtr<Counted> survivor;
+        {
+            auto objects = MakeSharedTuple<Counted, int, Counted>(
+                std::make_tuple(1), std::make_tuple(2), std::make_tuple(3));
+            survivor = std::get<2>(objects);
+            REQUIRE(Counted::alive == 2);
+        }
+        REQUIRE(Counted::alive == 2);
+        REQUIRE(survivor->value == 3);
+        survivor.Reset();
+        REQUIRE(Counted::alive == 0);
+    }
+}
+
+TEST_CASE("NoWeak") {
+    SECTION("No weak counter in the block") {
+        static_assert(sizeof(ControlBlockHolder<int, StrongControlBlockBase>) <
+                      sizeof(ControlBlockHolder<int>));
+        static_assert(!std::is_constructible_v<WeakPtr<int>, SharedPtr<int, NoWeak>>);
+        static_assert(!std::is_constructible_v<SharedPtr<int>, SharedPtr<int, NoWeak>>);
+    }
+
+    SECTION("Lifetime") {
+        Counted::alive = 0;
+        {
+            auto a = MakeSharedNoWeak<Counted>(1);
+            SharedPtr<Counted, NoWeak> b = a;
+            SharedPtr<Counted, NoWeak> c(new Counted(2));
+            REQUIRE(a.UseCount() == 2);
+            REQUIRE(Counted::alive == 2);
+
+            b = std::move(c);
+            REQUIRE(a.UseCount() == 1);
+            REQUIRE(b->value == 2);
+            REQUIRE(a != b);
+        }
+        REQUIRE(Counted::alive == 0);
+    }
+
+    SECTION("One allocation") {
+        EXPECT_ONE_ALLOCATION(REQUIRE(*MakeSharedNoWeak<int>(42) == 42));
+    }
+
+    SECTION("Conversions") {
+        B::destructor_called = false;
+        {
+            SharedPtr<A, NoWeak> base = MakeSharedNoWeak<B>();
+            SharedPtr<const A, NoWeak> const_base = base;
+            REQUIRE(const_base.UseCount() == 2);
+        }
+        REQUIRE(B::destructor_called);
+    }
+}
+
+TEST_CASE("Block reuse") {
+    SECTION("Emplace in place") {
+        auto p = MakeShared<std::string>("aba");
+        std::string* old = p.Get();
+
+        EXPECT_ZERO_ALLOCATIONS(p.Emplace(3, 'c'));
+        REQUIRE(p.Get() == old);
+        REQUIRE(*p == "ccc");
+        REQUIRE(p.UseCount() == 1);
+    }
+
+    SECTION("Emplace when shared") {
+        auto p = MakeShared<int>(1);
+        SharedPtr<int> q = p;
+
+        EXPECT_ONE_ALLOCATION(p.Emplace(2));
+        REQUIRE(*p == 2);
+        REQUIRE(*q == 1);
+        REQUIRE(p.UseCount() == 1);
+        REQUIRE(q.UseCount() == 1);
+    }
+
+    SECTION("Emplace with a weak observer") {
+        auto p = MakeShared<int>(1);
+        WeakPtr<int> weak = p;
+
+        p.Emplace(2);
+        REQUIRE(weak.Expired());
+        REQUIRE(*p == 2);
+    }
+
+    SECTION("Emplace into an empty or adopted pointer") {
+        SharedPtr<int> empty;
+        empty.Emplace(5);
+        REQUIRE(*empty == 5);
+
+        SharedPtr<const int> adopted(new int(6));
+        adopted.Emplace(7);
+        REQUIRE(*adopted == 7);
+        EXPECT_ZERO_ALLOCATIONS(adopted.Emplace(8));
+        REQUIRE(*adopted == 8);
+    }
+
+    SECTION("Faulty constructor in place") {
+        struct MaybeThrowing {
+            explicit MaybeThrowing(bool should_throw) {
+                if (should_throw) {
+                    throw 42;
+                }
+            }
+        };
+        auto p = MakeShared<MaybeThrowing>(false);
+        REQUIRE_THROWS(p.Emplace(true));
+        REQUIRE(!p);
+        REQUIRE(p.UseCount() == 0);
+    }
+
+    SECTION("Reset recycles the block") {
+        SharedPtr<int> p(new int(1));
+        EXPECT_ONE_ALLOCATION(p.Reset(new int(2)));
+        REQUIRE(*p == 2);
+        REQUIRE(p.UseCount() == 1);
+
+        SharedPtr<int> q = p;
+        p.Reset(new int(3));
+        REQUIRE(*q == 2);
+        REQUIRE(*p == 3);
+        REQUIRE(q.UseCount() == 1);
+    }
+
+    SECTION("Reset with a derived type") {
+        B::destructor_called = false;
+        SharedPtr<A> ptr(new B);
+        ptr.Reset(new B);
+        REQUIRE(B::destructor_called);
+        B::destructor_called = false;
+        ptr.Reset(new A);
+        REQUIRE(B::destructor_called);
+    }
+}
+
+TEST_CASE("TryUnwrap") {
+    SECTION("Unique owner") {
+        Counted::alive = 0;
+        auto shared = MakeShared<Counted>(5);
+        Counted* raw = shared.Get();
+        {
+            auto unique = shared.TryUnwrap();
+            REQUIRE(!shared);
+            REQUIRE(shared.UseCount() == 0);
+            REQUIRE(unique.Get() == raw);
+            unique->value = 6;
+            REQUIRE(Counted::alive == 1);
+        }
+        REQUIRE(Counted::alive == 0);
+    }
+
+    SECTION("Shared or observed") {
+        auto shared = MakeShared<int>(1);
+        SharedPtr<int> copy = shared;
+        REQUIRE(!shared.TryUnwrap());
+        REQUIRE(shared.UseCount() == 2);
+
+        copy.Reset();
+        WeakPtr<int> weak = shared;
+        REQUIRE(!shared.TryUnwrap());
+        REQUIRE(*shared == 1);
+
+        weak.Reset();
+        REQUIRE(shared.TryUnwrap());
+        REQUIRE(!SharedPtr<int>().TryUnwrap());
+    }
+
+    SECTION("Adopted pointer and upcast") {
+        B::destructor_called = false;
+        SharedPtr<B> shared(new B);
+        {
+            UniquePtr<A, ControlBlockDeleter<>> unique = shared.TryUnwrap();
+            REQUIRE(unique);
+        }
+        REQUIRE(B::destructor_called);
+    }
+
+    SECTION("No allocations") {
+        auto shared = MakeSharedNoWeak<int>(3);
+        EXPECT_ZERO_ALLOCATIONS(REQUIRE(*shared.TryUnwrap() == 3));
+    }
+
+    SECTION("Release leaves the block in the deleter") {
+        Counted::alive = 0;
+        auto unique = MakeShared<Counted>(7).TryUnwrap();
+        ControlBlockDeleter<> deleter = std::move(unique.GetDeleter());
+        REQUIRE(deleter.GetBlock() != nullptr);
+        REQUIRE(unique.GetDeleter().GetBlock() == nullptr);
+
+        Counted* raw = unique.Release();
+        REQUIRE(Counted::alive == 1);
+
+        UniquePtr<Counted, ControlBlockDeleter<>> again(raw, std::move(deleter));
+        REQUIRE(again->value == 7);
+        again.Reset();
+        REQUIRE(Counted::alive == 0);
+    }
+}
+
+struct CountingDeleter {
+    void operator()(int* ptr) {
+        if (ptr != nullptr) {
+            ++*calls;
+        }
+        delete ptr;
+    }
+
+    int* calls;
+};
+
+TEST_CASE("SharedPtr from UniquePtr") {
+    SECTION("Default deleter") {
+        B::destructor_called = false;
+        {
+            UniquePtr<B> unique(new B);
+            SharedPtr<A> shared(std::move(unique));
+            REQUIRE(!unique);
+            REQUIRE(shared.UseCount() == 1);
+        }
+        REQUIRE(B::destructor_called);
+    }
+
+    SECTION("Custom deleter is kept") {
+        int calls = 0;
+        {
+            UniquePtr<int, CountingDeleter> unique(new int(4), CountingDeleter{&calls});
+            SharedPtr<int> shared = std::move(unique);
+            SharedPtr<int> copy = shared;
+            REQUIRE(*copy == 4);
+        }
+        REQUIRE(calls == 1);
+    }
+
+    SECTION("Empty") {
+        EXPECT_ZERO_ALLOCATIONS(SharedPtr<int> shared{UniquePtr<int>()});
+    }
+
+    SECTION("Promotable") {
+        Counted::alive = 0;
+        auto unique = MakeUniquePromotable<Counted>(8);
+        unique->value = 9;
+        {
+            SharedPtr<Counted> shared;
+            EXPECT_ZERO_ALLOCATIONS(shared = SharedPtr<Counted>(std::move(unique)));
+            REQUIRE(shared->value == 9);
+            REQUIRE(shared.UseCount() == 1);
+            REQUIRE(Counted::alive == 1);
+        }
+        REQUIRE(Counted::alive == 0);
+    }
+
+    SECTION("Promotable dropped without promotion") {
+        Counted::alive = 0;
+        {
+            auto unique = MakeUniquePromotable<Counted>(1);
+        }
+        REQUIRE(Counted::alive == 0);
+    }
+
+    SECTION("Round trip") {
+        auto shared = MakeShared<int>(10);
+        int* raw = shared.Get();
+        SharedPtr<int> again(shared.TryUnwrap());
+        REQUIRE(again.Get() == raw);
+        REQUIRE(again.UseCount() == 1);
+    }
+}
+
+TEST_CASE("Lazy control block") {
+    SECTION("Sole owner allocates only the object") {
+        Counted::alive = 0;
+        auto* raw = new Counted(1);
+        EXPECT_ZERO_ALLOCATIONS({
+            SharedPtr<Counted> ptr(raw, kLazyControlBlock);
+            REQUIRE(ptr.UseCount() == 1);
+            REQUIRE(ptr->value == 1);
+            SharedPtr<Counted> moved = std::move(ptr);
+            REQUIRE(!ptr);
+        });
+        REQUIRE(Counted::alive == 0);
+    }
+
+    SECTION("First copy allocates the block") {
+        SharedPtr<int> ptr(new int(2), kLazyControlBlock);
+        SharedPtr<int> copy;
+        EXPECT_ONE_ALLOCATION(copy = ptr);
+        REQUIRE(ptr.UseCount() == 2);
+        EXPECT_ZERO_ALLOCATIONS(SharedPtr<int> third(copy));
+        ptr.Reset();
+        REQUIRE(*copy == 2);
+        REQUIRE(copy.UseCount() == 1);
+    }
+
+    SECTION("Weak and converted pointers") {
+        SharedPtr<int> ptr(new int(3), kLazyControlBlock);
+        WeakPtr<int> weak(ptr);
+        REQUIRE(!weak.Expired());
+        ptr.Reset();
+        REQUIRE(weak.Expired());
+
+        B::destructor_called = false;
+        SharedPtr<B> derived(new B, kLazyControlBlock);
+        SharedPtr<A> base = std::move(derived);
+        base.Reset();
+        REQUIRE(B::destructor_called);
+    }
+
+    SECTION("Reset and unwrap") {
+        Counted::alive = 0;
+        SharedPtr<Counted> ptr(new Counted(4), kLazyControlBlock);
+        ptr.Reset(new Counted(5));
+        REQUIRE(Counted::alive == 1);
+        REQUIRE(ptr->value == 5);
+        {
+            auto unique = ptr.TryUnwrap();
+            REQUIRE(unique->value == 5);
+            REQUIRE(!ptr);
+        }
+        REQUIRE(Counted::alive == 0);
+        REQUIRE(!SharedPtr<int>(nullptr, kLazyControlBlock));
+    }
+
+    SECTION("Derived adopted through a base pointer") {
+        B::destructor_called = false;
+        B* raw = new B;
+        EXPECT_ZERO_ALLOCATIONS(SharedPtr<A> ptr(raw, kLazyControlBlock));
+        REQUIRE(B::destructor_called);
+
+        B::destructor_called = false;
+        SharedPtr<A> first(new B, kLazyControlBlock);
+        SharedPtr<A> copy = first;
+        first.Reset();
+        copy.Reset();
+        REQUIRE(B::destructor_called);
+
+        B::destructor_called = false;
+        SharedPtr<A> unwrapped(new B, kLazyControlBlock);
+        unwrapped.TryUnwrap();
+        REQUIRE(B::destructor_called);
+
+        B::destructor_called = false;
+        SharedPtr<A> reset(new B, kLazyControlBlock);
+        reset.Reset(new A);
+        REQUIRE(B::destructor_called);
+        REQUIRE(reset.UseCount() == 1);
+    }
+}
+
+struct Event {
+    virtual ~Event() = default;
+};
+
+struct KeyEvent : Event {
+    int key = 0;
+};
+
+TEST_CASE("Pointer casts") {
+    SECTION("Copying casts") {
+        SharedPtr<Event> event = MakeShared<KeyEvent>();
+        auto key = DynamicPointerCast<KeyEvent>(event);
+        REQUIRE(key.Get() == event.Get());
+        REQUIRE(event.UseCount() == 2);
+        REQUIRE(!DynamicPointerCast<Counted>(event));
+        REQUIRE(event.UseCount() == 2);
+
+        auto base = StaticPointerCast<Event>(key);
+        SharedPtr<const KeyEvent> constant = key;
+        auto mutable_key = ConstPointerCast<KeyEvent>(constant);
+        mutable_key->key = 7;
+        REQUIRE(key->key == 7);
+        auto raw = ReinterpretPointerCast<char>(key);
+        REQUIRE(raw.Get() == reinterpret_cast<char*>(key.Get()));
+        REQUIRE(event.UseCount() == 6);
+    }
+
+    SECTION("Moving casts steal the reference") {
+        SharedPtr<Event> event = MakeShared<KeyEvent>();
+        SharedPtr<Event> other = event;
+        auto key = DynamicPointerCast<KeyEvent>(std::move(event));
+        REQUIRE(!event);
+        REQUIRE(key.UseCount() == 2);
+
+        auto failed = DynamicPointerCast<Counted>(std::move(other));
+        REQUIRE(!failed);
+        REQUIRE(other);
+        REQUIRE(key.UseCount() == 2);
+
+        auto back = StaticPointerCast<Event>(std::move(key));
+        REQUIRE(!key);
+        REQUIRE(back.UseCount() == 2);
+        auto constant = ConstPointerCast<const Event>(std::move(back));
+        auto raw = ReinterpretPointerCast<const char>(std::move(constant));
+        REQUIRE(raw.UseCount() == 2);
+    }
+
+    SECTION("Lazy block") {
+        SharedPtr<Event> event(new KeyEvent, kLazyControlBlock);
+        auto key = StaticPointerCast<KeyEvent>(std::move(event));
+        REQUIRE(key.UseCount() == 1);
+    }
+
+    SECTION("WeakPtr") {
+        SharedPtr<Event> event = MakeShared<KeyEvent>();
+        WeakPtr<Event> weak = event;
+        WeakPtr<KeyEvent> key = DynamicPointerCast<KeyEvent>(weak);
+        REQUIRE(key.Lock().Get() == event.Get());
+        REQUIRE(DynamicPointerCast<Counted>(weak).Expired());
+
+        WeakPtr<Event> moved = StaticPointerCast<Event>(std::move(key));
+        REQUIRE(key.Expired());
+        REQUIRE(moved.Lock() == event);
+        REQUIRE(event.UseCount() == 1);
+
+        event.Reset();
+        REQUIRE(DynamicPointerCast<KeyEvent>(std::move(weak)).Expired());
+    }
+}
+
+TEST_CASE("Hashing and ordering") {
+    SECTION("Owner-based") {
+        auto [first, second] = MakeSharedTuple<int, int>();
+        auto other = MakeShared<int>(0);
+        REQUIRE(first.OwnerEqual(second));
+        REQUIRE(first.OwnerHash() == second.OwnerHash());
+        REQUIRE(!first.OwnerEqual(other));
+        REQUIRE(first.OwnerBefore(other) != other.OwnerBefore(first));
+        REQUIRE(!first.OwnerBefore(second));
+
+        WeakPtr<int> weak = second;
+        REQUIRE(weak.OwnerEqual(first));
+        REQUIRE(OwnerEqual()(first, weak));
+        REQUIRE(!OwnerLess()(weak, first));
+    }
+
+    SECTION("Weak keys outlive their objects") {
+        std::unordered_map<WeakPtr<int>, int, OwnerHash, OwnerEqual> table;
+        auto value = MakeShared<int>(1);
+        WeakPtr<int> weak = value;
+        table[weak] = 1;
+        value.Reset();
+        REQUIRE(table.count(weak) == 1);
+        table.erase(weak);
+        REQUIRE(table.empty());
+    }
+
+    SECTION("Lazy blocks are told apart") {
+        SharedPtr<int> first(new int(1), kLazyControlBlock);
+        SharedPtr<int> second(new int(2), kLazyControlBlock);
+        REQUIRE(!first.OwnerEqual(second));
+        REQUIRE(first.OwnerEqual(SharedPtr<int>(first)));
+    }
+
+    SECTION("Lookup by raw pointer") {
+        std::unordered_set<SharedPtr<int>, PointerHash, PointerEqual> shared;
+        auto value = MakeShared<int>(2);
+        shared.insert(value);
+        REQUIRE(shared.find(value.Get()) != shared.end());
+        int unrelated = 0;
+        REQUIRE(shared.find(&unrelated) == shared.end());
+
+        std::unordered_set<WeakPtr<int>, PointerHash, PointerEqual> weak;
+        weak.insert(WeakPtr<int>(value));
+        REQUIRE(weak.find(value.Get()) != weak.end());
+        REQUIRE(weak.find(value) != weak.end());
+    }
+
+    SECTION("std::hash") {
+        std::unordered_set<SharedPtr<int>> set;
+        auto value = MakeShared<int>(3);
+        set.insert(value);
+        REQUIRE(set.count(value) == 1);
+        REQUIRE(std::hash<SharedPtr<int>>()(value) == std::hash<int*>()(value.Get()));
+    }
+}
+
+TEST_CASE("std::shared_ptr interop") {
+    SECTION("Adopting") {
+        Counted::alive = 0;
+        auto std_ptr = std::make_shared<Counted>(1);
+        {
+            SharedPtr<Counted> ptr = std_ptr;
+            REQUIRE(ptr.Get() == std_ptr.get());
+            REQUIRE(std_ptr.use_count() == 2);
+            SharedPtr<Counted> copy = ptr;
+            REQUIRE(ptr.UseCount() == 2);
+            std_ptr.reset();
+            REQUIRE(Counted::alive == 1);
+        }
+        REQUIRE(Counted::alive == 0);
+        REQUIRE(!SharedPtr<int>(std::shared_ptr<int>()));
+    }
+
+    SECTION("Exporting") {
+        B::destructor_called = false;
+        SharedPtr<B> ptr(new B);
+        std::shared_ptr<B> std_ptr = ToStdShared(ptr);
+        REQUIRE(std_ptr.get() == ptr.Get());
+        REQUIRE(ptr.UseCount() == 2);
+        ptr.Reset();
+        REQUIRE(!B::destructor_called);
+        std_ptr.reset();
+        REQUIRE(B::destructor_called);
+        REQUIRE(!ToStdShared(SharedPtr<int>()));
+    }
+
+    SECTION("Round trips reuse the original block") {
+        auto ptr = MakeShared<int>(2);
+        std::shared_ptr<int> std_ptr = ToStdShared(ptr);
+        SharedPtr<int> back;
+        EXPECT_ZERO_ALLOCATIONS(back = SharedPtr<int>(std_ptr));
+        REQUIRE(back.block_ == ptr.block_);
+        REQUIRE(ptr.UseCount() == 3);
+
+        auto original = std::make_shared<int>(3);
+        SharedPtr<int> adopted = original;
+        std::shared_ptr<int> again;
+        EXPECT_ZERO_ALLOCATIONS(again = ToStdShared(adopted));
+        REQUIRE(again.get() == original.get());
+        REQUIRE(original.use_count() == 3);
+    }
+
+    SECTION("Other std::shared_ptr owners count for uniqueness") {
+        auto std_ptr = std::make_shared<int>(4);
+        SharedPtr<int> ptr = std_ptr;
+        REQUIRE(ptr.UseCount() == 1);
+        REQUIRE(!ptr.IsUnique());
+        REQUIRE(!ptr.TryUnwrap());
+        REQUIRE(*ptr == 4);
+
+        std_ptr.reset();
+        REQUIRE(ptr.IsUnique());
+        auto unique = ptr.TryUnwrap();
+        REQUIRE(*unique == 4);
+    }
+}
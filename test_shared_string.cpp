@@ -0,0 +1,144 @@
+#include "shared_string.h"
+
+#include <catch.hpp>
+
+#include "allocations_checker.h"
+
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+constexpr size_t kPieceSize = SharedRope::kFlattenThreshold;
+
+}  // namespace
+
+TEST_CASE("SharedString") {
+    SECTION("One allocation for header and characters") {
+        SharedString text;
+        EXPECT_ONE_ALLOCATION(text = SharedString("hello, world"));
+        REQUIRE(text.Size() == 12);
+        EXPECT_ZERO_ALLOCATIONS(text = SharedString(""));
+        REQUIRE(text.Empty());
+    }
+
+    SECTION("Substrings alias the parent") {
+        SharedString text("GET /index.html HTTP/1.1");
+        SharedString path;
+        EXPECT_ZERO_ALLOCATIONS(path = text.Substr(4, 11));
+        REQUIRE(path.View() == "/index.html");
+        REQUIRE(path.Data() == text.Data() + 4);
+        REQUIRE(path.SharesWith(text));
+        REQUIRE(path.Substr(1).SharesWith(text));
+        REQUIRE(text.Substr(16, 100).View() == "HTTP/1.1");
+        REQUIRE(text.Substr(text.Size()).Empty());
+        REQUIRE_THROWS_AS(text.Substr(text.Size() + 1), std::out_of_range);
+    }
+
+    SECTION("Substrings keep the buffer alive") {
+        SharedString word;
+        {
+            SharedString text("the quick brown fox");
+            word = text.Substr(10, 5);
+        }
+        REQUIRE(word.View() == "brown");
+        REQUIRE(word[0] == 'b');
+    }
+
+    SECTION("Comparison and hashing by contents") {
+        SharedString first("abc");
+        SharedString second("xabcx");
+        REQUIRE(first == second.Substr(1, 3));
+        REQUIRE_FALSE(first.SharesWith(second));
+        REQUIRE(first < second);
+        std::unordered_set<SharedString> set{first};
+        REQUIRE(set.contains(second.Substr(1, 3)));
+    }
+
+    SECTION("Moved-from strings are empty") {
+        SharedString text("payload");
+        SharedString moved = std::move(text);
+        REQUIRE(moved.View() == "payload");
+        REQUIRE(text.Empty());
+        REQUIRE(text.View().empty());
+
+        text = SharedString("other");
+        moved = std::move(text);
+        REQUIRE(moved.View() == "other");
+        REQUIRE(text.Size() == 0);
+    }
+}
+
+TEST_CASE("SharedRope") {
+    SECTION("Concatenation links nodes without copying") {
+        SharedString left(std::string(100, 'a'));
+        SharedString right(std::string(50, 'b'));
+        SharedRope left_rope(left);
+        SharedRope right_rope(right);
+        SharedRope rope;
+        EXPECT_ONE_ALLOCATION(rope = left_rope + right_rope);
+        REQUIRE(rope.Size() == 150);
+        REQUIRE(rope[99] == 'a');
+        REQUIRE(rope[100] == 'b');
+
+        std::vector<std::string_view> chunks;
+        rope.ForEachChunk([&chunks](std::string_view chunk) { chunks.push_back(chunk); });
+        REQUIRE(chunks.size() == 2);
+        REQUIRE(chunks[0].data() == left.Data());
+        REQUIRE(chunks[1].data() == right.Data());
+    }
+
+    SECTION("Short pieces are flattened") {
+        SharedRope rope = SharedRope(SharedString("key")) + SharedString("=") + SharedString("v");
+        int chunks = 0;
+        rope.ForEachChunk([&chunks](std::string_view) { ++chunks; });
+        REQUIRE(chunks == 1);
+        REQUIRE(rope.ToString() == "key=v");
+    }
+
+    SECTION("Flatten and substrings of the result") {
+        SharedString line(std::string(60, '-'));
+        SharedRope rope;
+        for (int i = 0; i < 10; ++i) {
+            rope = rope + line + SharedString("\n");
+        }
+        REQUIRE(rope.Size() == 610);
+        SharedString flat;
+        EXPECT_ONE_ALLOCATION(flat = rope.Flatten());
+        REQUIRE(flat.View() == rope.ToString());
+        REQUIRE(flat.Substr(60, 1).View() == "\n");
+        REQUIRE(rope[609] == '\n');
+        REQUIRE((SharedRope() + SharedRope()).Empty());
+    }
+
+    SECTION("Long chains of appends stay balanced") {
+        const size_t pieces = 100000;
+        SharedString piece(std::string(kPieceSize, 'x') + "\n");
+        SharedRope appended;
+        SharedRope prepended;
+        for (size_t i = 0; i < pieces; ++i) {
+            appended = appended + piece;
+            prepended = piece + prepended;
+        }
+        REQUIRE(appended.Size() == pieces * piece.Size());
+        REQUIRE(appended.Depth() <= 25);  // 1.44 * log2(100000)
+        REQUIRE(prepended.Depth() <= 25);
+        REQUIRE(appended[piece.Size() * 5000 - 1] == '\n');
+        REQUIRE(prepended[piece.Size() * 5000] == 'x');
+
+        size_t chunks = 0;
+        appended.ForEachChunk([&chunks, &piece](std::string_view chunk) {
+            chunks += chunk.data() == piece.Data() ? 1 : 0;
+        });
+        REQUIRE(chunks == pieces);
+        REQUIRE(appended.Flatten().View() == prepended.ToString());
+    }
+
+    SECTION("A single piece flattens to itself") {
+        SharedString text(std::string(200, 'x'));
+        REQUIRE(SharedRope(text).Flatten().SharesWith(text));
+    }
+}
@@ -0,0 +1,123 @@
+#include "soft.h"
+
+#include <common/my_int.h>
+
+#include <catch.hpp>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("Empty soft") {
+    SoftPtr<int> a;
+    SoftPtr<int> b(SharedPtr<int>{});
+
+    REQUIRE(a.Expired());
+    REQUIRE(!b.IsResident());
+    REQUIRE(a.Lock().Get() == nullptr);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("Soft keeps object alive") {
+    SoftBudget budget;
+    SoftPtr<MyInt> soft(MakeShared<MyInt>(42), sizeof(MyInt), budget);
+
+    REQUIRE(MyInt::AliveCount() == 1);
+    REQUIRE(!soft.Expired());
+    REQUIRE(soft.IsResident());
+    REQUIRE(*soft.Lock() == 42);
+    REQUIRE(budget.GetUsage() == sizeof(MyInt));
+
+    SoftPtr<MyInt> copy = soft;
+    soft.Reset();
+    REQUIRE(MyInt::AliveCount() == 1);
+
+    copy.Reset();
+    REQUIRE(MyInt::AliveCount() == 0);
+    REQUIRE(budget.GetUsage() == 0);
+    REQUIRE(budget.GetResidentCount() == 0);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("Budget eviction") {
+    SoftBudget budget(2);
+    SoftPtr<MyInt> first(MakeShared<MyInt>(1), 1, budget);
+    SoftPtr<MyInt> second(MakeShared<MyInt>(2), 1, budget);
+    REQUIRE(MyInt::AliveCount() == 2);
+
+    SECTION("Least recently used goes first") {
+        budget.Shrink(2);  // clears the reference bits
+        second.Lock();
+
+        SoftPtr<MyInt> third(MakeShared<MyInt>(3), 1, budget);
+
+        REQUIRE(first.Expired());
+        REQUIRE(!second.Expired());
+        REQUIRE(!third.Expired());
+        REQUIRE(MyInt::AliveCount() == 2);
+        REQUIRE(budget.GetUsage() == 2);
+    }
+
+    SECTION("Evicted but still shared") {
+        SharedPtr<MyInt> owner = first.Lock();
+        budget.SetBudget(0);
+
+        REQUIRE(!first.IsResident());
+        REQUIRE(!first.Expired());
+        REQUIRE(second.Expired());
+        REQUIRE(*first.Lock() == 1);
+
+        owner.Reset();
+        REQUIRE(first.Expired());
+        REQUIRE(MyInt::AliveCount() == 0);
+    }
+}
+
+TEST_CASE("Zero-byte entries outlive their budget") {
+    SoftPtr<MyInt> empty;
+    {
+        SoftBudget budget(1);
+        empty = SoftPtr<MyInt>(MakeShared<MyInt>(1), 0, budget);
+        REQUIRE(budget.Shrink(0) == 0);  // nothing to free, so the entry stays
+        REQUIRE(empty.IsResident());
+        REQUIRE(budget.GetResidentCount() == 1);
+    }
+    REQUIRE(!empty.IsResident());
+    REQUIRE(empty.Expired());
+    REQUIRE(MyInt::AliveCount() == 0);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("Memory pressure") {
+    SoftBudget budget;
+    SoftPtr<MyInt> soft(MakeShared<MyInt>(7), 1, budget);
+
+    budget.SetPressureThreshold(2.0);
+    REQUIRE(budget.RelieveMemoryPressure() == 0);
+    REQUIRE(!soft.Expired());
+
+    budget.SetPressureThreshold(-1.0);
+    REQUIRE(budget.RelieveMemoryPressure() == 1);
+    REQUIRE(soft.Expired());
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("Register checks memory pressure") {
+    SoftBudget budget;
+    budget.SetPressureThreshold(-1.0);
+    budget.SetPressureCheckInterval(2);
+
+    SoftPtr<MyInt> first(MakeShared<MyInt>(1), 1, budget);
+    REQUIRE(first.IsResident());
+
+    SoftPtr<MyInt> second(MakeShared<MyInt>(2), 1, budget);
+    REQUIRE(budget.GetUsage() == 1);
+    REQUIRE(MyInt::AliveCount() == 1);
+
+    budget.SetPressureCheckInterval(0);
+    SoftPtr<MyInt> third(MakeShared<MyInt>(3), 1, budget);
+    SoftPtr<MyInt> fourth(MakeShared<MyInt>(4), 1, budget);
+    REQUIRE(budget.GetUsage() == 3);
+}
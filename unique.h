@@ -1,9 +1,32 @@
 #pragma once
 
 #include <cstddef>  // std::nullptr_t
+#include <memory>
+#include <type_traits>
+#include <utility>  // std::forward
 
 #include "compressed_pair.h"
 
+namespace unique_detail {
+
+template <typename Deleter>
+struct IsDefaultDelete : std::false_type {};
+
+template <typename T>
+struct IsDefaultDelete<std::default_delete<T>> : std::true_type {};
+
+// `std::default_delete` turns into the default `UniquePtrDeleter`, other deleters are moved over
+template <typename Deleter, typename OtherDeleter>
+Deleter FromStdDeleter(OtherDeleter&& deleter) {
+    if constexpr (IsDefaultDelete<std::decay_t<OtherDeleter>>::value) {
+        return Deleter();
+    } else {
+        return Deleter(std::forward<OtherDeleter>(deleter));
+    }
+}
+
+}  // namespace unique_detail
+
 template <typename T>
 class UniquePtrDeleter {
 public:
@@ -55,6 +78,14 @@ public:
     UniquePtr(UniquePtr<OtherType, OtherDeleter>&& other) noexcept
         : data_(other.Release(), std::forward<OtherDeleter>(other.GetDeleter())){};
 
+    // Adopts the object of a `std::unique_ptr` together with its deleter
+    template <typename OtherType, typename OtherDeleter>
+    UniquePtr(std::unique_ptr<OtherType, OtherDeleter>&& other) noexcept
+        : data_(other.get(),
+                unique_detail::FromStdDeleter<Deleter>(std::move(other.get_deleter()))) {
+        other.release();
+    }
+
     ////////////////////////////////////////////////////////////////////////////////////////////////
     // `operator=`-s
 
@@ -154,6 +185,14 @@ public:
     UniquePtr(UniquePtr<OtherType, OtherDeleter>&& other) noexcept
         : data_(other.Release(), std::forward<OtherDeleter>(other.GetDeleter())){};
 
+    // Adopts the object of a `std::unique_ptr` together with its deleter
+    template <typename OtherType, typename OtherDeleter>
+    UniquePtr(std::unique_ptr<OtherType, OtherDeleter>&& other) noexcept
+        : data_(other.get(),
+                unique_detail::FromStdDeleter<Deleter>(std::move(other.get_deleter()))) {
+        other.release();
+    }
+
     ////////////////////////////////////////////////////////////////////////////////////////////////
     // `operator=`-s
 
@@ -236,3 +275,47 @@ public:
         return Get()[i];
     }
 };
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Factories
+
+template <typename T, typename... Args>
+std::enable_if_t<!std::is_array_v<T>, UniquePtr<T>> MakeUnique(Args&&... args) {
+    return UniquePtr<T>(new T(std::forward<Args>(args)...));
+}
+
+template <typename T>
+std::enable_if_t<std::is_unbounded_array_v<T>, UniquePtr<T>> MakeUnique(size_t size) {
+    return UniquePtr<T>(new std::remove_extent_t<T>[size]());
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Casts
+
+// Moves the object into a `UniquePtr<T>` if it is a `T`, keeping the deleter. Otherwise returns
+// an empty pointer and `ptr` keeps the object.
+template <typename T, typename U, typename Deleter>
+UniquePtr<T, Deleter> DynamicUniqueCast(UniquePtr<U, Deleter>&& ptr) {
+    T* result = dynamic_cast<T*>(ptr.Get());
+    if (result == nullptr) {
+        return UniquePtr<T, Deleter>();
+    }
+    UniquePtr<T, Deleter> cast(result, std::move(ptr.GetDeleter()));
+    ptr.Release();
+    return cast;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Interop with std::unique_ptr
+
+// Moves the object into a `std::unique_ptr`. The default deleter becomes `std::default_delete`.
+template <typename T, typename Deleter>
+auto ToStdUnique(UniquePtr<T, Deleter>&& ptr) {
+    if constexpr (std::is_same_v<Deleter, UniquePtrDeleter<T>>) {
+        return std::unique_ptr<T>(ptr.Release());
+    } else {
+        std::unique_ptr<T, Deleter> result(ptr.Get(), std::move(ptr.GetDeleter()));
+        ptr.Release();
+        return result;
+    }
+}
@@ -1,11 +1,13 @@
 #pragma once
 
+#include <functional>
+
 #include "sw_fwd.h"  // Forward declaration
 
 // https://en.cppreference.com/w/cpp/memory/weak_ptr
 template <typename T>
 class WeakPtr {
-    template <class U>
+    template <class U, class Policy>
     friend class SharedPtr;
 
 public:
@@ -25,7 +27,7 @@ protected:
             return;
         }
         if (block_->GetStrongCounter() == 0 && block_->GetWeakCounter() <= 1) {
-            delete block_;
+            block_->DestroyBlock();
             return;
         }
         block_->DecrementWeakCounter();
@@ -51,10 +53,22 @@ public:
         other.block_ = nullptr;
     }
 
+    // Aliasing constructors: observe the object of `other` through a different pointer
+    template <typename U>
+    WeakPtr(const WeakPtr<U>& other, T* ptr) : ptr_(ptr), block_(other.block_) {
+        IncrementBlockWeakCounter();
+    }
+
+    template <typename U>
+    WeakPtr(WeakPtr<U>&& other, T* ptr) : ptr_(ptr), block_(other.block_) {
+        other.ptr_ = nullptr;
+        other.block_ = nullptr;
+    }
+
     // Demote `SharedPtr`
     // #2 from https://en.cppreference.com/w/cpp/memory/weak_ptr/weak_ptr
     template <typename U>
-    WeakPtr(const SharedPtr<U>& other) : ptr_(other.ptr_), block_(other.block_) {
+    WeakPtr(const SharedPtr<U>& other) : ptr_(other.ptr_), block_(other.MaterializeBlock()) {
         IncrementBlockWeakCounter();
     }
 
@@ -119,4 +133,22 @@ public:
         }
         return SharedPtr<T>(*this);
     }
+
+    // Identifies the control block; stays valid after the object expires
+    const void* GetOwner() const {
+        return block_;
+    }
+
+    // Owner-based ordering and equality, see `SharedPtr::OwnerBefore`
+    template <typename Other>
+    bool OwnerBefore(const Other& other) const {
+        return std::less<const void*>()(GetOwner(), other.GetOwner());
+    }
+    template <typename Other>
+    bool OwnerEqual(const Other& other) const {
+        return GetOwner() == other.GetOwner();
+    }
+    size_t OwnerHash() const {
+        return std::hash<const void*>()(GetOwner());
+    }
 };